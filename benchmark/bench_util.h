@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace med_bench {
+
+class Timer {
+public:
+    Timer() : start_(std::chrono::steady_clock::now()) {}
+    void Reset() { this->start_ = std::chrono::steady_clock::now(); }
+    double ElapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// 1, 2, 4, ... up to the number of hardware threads (always included)
+inline std::vector<size_t> ThreadCounts() {
+    size_t max_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    std::vector<size_t> counts;
+    for (size_t n = 1; n < max_threads; n *= 2) {
+        counts.push_back(n);
+    }
+    counts.push_back(max_threads);
+    return counts;
+}
+
+// best of `repeat` runs, in milliseconds
+template <typename F>
+double BestOfMs(int repeat, F&& f) {
+    double best = 0;
+    for (int i = 0; i < repeat; ++i) {
+        Timer timer;
+        f();
+        double cost = timer.ElapsedMs();
+        if (i == 0 || cost < best) {
+            best = cost;
+        }
+    }
+    return best;
+}
+
+// keeps the optimizer from discarding a computed value
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+}  // namespace med_bench
@@ -0,0 +1,84 @@
+// Get/Set throughput of ConcurrentLRUCache with exact LRU shards against CLOCK shards, for 90/10 and 99/1
+// read/write mixes over a skewed key set where most reads hit a few hot keys (and so a few shards).
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "concurrent_lru_cache/concurrent_lru_cache.h"
+
+namespace {
+
+const int kCapacity = 100000;
+const int kShards = 16;
+const int kOpsPerThread = 1000000;
+
+class Random {
+public:
+    explicit Random(uint64_t seed) : state_(seed) {}
+    uint32_t Next() {
+        this->state_ = this->state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(this->state_ >> 33);
+    }
+
+private:
+    uint64_t state_;
+};
+
+// 80% of the accesses go to 64 hot keys, the rest spreads over twice the capacity
+int NextKey(Random& random) {
+    uint32_t r = random.Next();
+    return r % 10 < 8 ? static_cast<int>(r % 64) : static_cast<int>(r % (2 * kCapacity));
+}
+
+template <typename Cache>
+double Mops(size_t threads, int read_percent) {
+    Cache cache(kCapacity, kShards);
+    for (int i = 0; i < kCapacity; ++i) {
+        cache.Set(i, i);
+    }
+    double ms = med_bench::BestOfMs(3, [&] {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                Random random(t + 1);
+                int64_t sum = 0;
+                for (int i = 0; i < kOpsPerThread; ++i) {
+                    int key = NextKey(random);
+                    if (static_cast<int>(random.Next() % 100) < read_percent) {
+                        int v = 0;
+                        if (cache.Get(key, v)) {
+                            sum += v;
+                        }
+                    } else {
+                        cache.Set(key, key);
+                    }
+                }
+                med_bench::DoNotOptimize(sum);
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    });
+    return threads * kOpsPerThread / ms / 1e3;
+}
+
+}  // namespace
+
+int main() {
+    using LRU = med::ConcurrentLRUCache<int, int>;
+    using Clock = med::ConcurrentLRUCache<int, int, false, std::hash<int>, med::EvictionPolicy::kClock>;
+    std::printf("%-8s %-8s %14s %14s\n", "mix", "threads", "LRU Mops/s", "CLOCK Mops/s");
+    for (int read_percent : {90, 99}) {
+        for (size_t threads : med_bench::ThreadCounts()) {
+            double lru = Mops<LRU>(threads, read_percent);
+            double clock = Mops<Clock>(threads, read_percent);
+            std::printf("%2d/%-5d %-8zu %14.1f %14.1f\n", read_percent, 100 - read_percent, threads, lru, clock);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+// LRUCache (std::list + std::unordered_map) against FlatLRUCache with 1M int64 keys and values: bytes taken from the
+// heap per entry, ns per Set while filling, and ns per Get and Set once full, with a miss rate of about 1/2 on Get
+// and every Set evicting.
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "benchmark/bench_util.h"
+#include "concurrent_lru_cache/concurrent_lru_cache.h"
+
+namespace {
+
+const int kCapacity = 1000000;
+const int kOps = 4000000;
+
+// bytes asked from operator new, freed memory is not subtracted
+size_t g_heap_bytes = 0;
+
+class Random {
+public:
+    uint32_t Next() {
+        this->state_ = this->state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(this->state_ >> 33);
+    }
+
+private:
+    uint64_t state_ = 7;
+};
+
+template <typename Cache>
+void Run(const char* name) {
+    size_t heap_bytes = g_heap_bytes;
+    Cache cache(kCapacity);
+    med_bench::Timer fill_timer;
+    for (int64_t i = 0; i < kCapacity; ++i) {
+        cache.Set(i, i);
+    }
+    double fill_ms = fill_timer.ElapsedMs();
+    double bytes_per_entry = static_cast<double>(g_heap_bytes - heap_bytes) / kCapacity;
+
+    Random random;
+    int64_t v = 0;
+    int64_t hits = 0;
+    med_bench::Timer get_timer;
+    for (int i = 0; i < kOps; ++i) {
+        hits += cache.Get(static_cast<int64_t>(random.Next() % (2 * kCapacity)), v);
+    }
+    double get_ms = get_timer.ElapsedMs();
+    med_bench::DoNotOptimize(hits);
+
+    med_bench::Timer set_timer;
+    for (int64_t i = 0; i < kOps; ++i) {
+        cache.Set(kCapacity * 2 + i, i);
+    }
+    double set_ms = set_timer.ElapsedMs();
+
+    std::printf("%-14s %16.1f %14.1f %12.1f %16.1f\n", name, bytes_per_entry, fill_ms * 1e6 / kCapacity,
+                get_ms * 1e6 / kOps, set_ms * 1e6 / kOps);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    g_heap_bytes += size;
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+int main() {
+    std::printf("%-14s %16s %14s %12s %16s\n", "layout", "heap bytes/entry", "fill ns/Set", "ns/Get",
+                "evicting ns/Set");
+    Run<med::LRUCache<int64_t, int64_t>>("list + map");
+    Run<med::FlatLRUCache<int64_t, int64_t>>("flat");
+    return 0;
+}
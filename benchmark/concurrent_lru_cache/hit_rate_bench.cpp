@@ -0,0 +1,87 @@
+// Trace driven hit rates of LRUCache, ClockCache and TinyLFUCache, every miss followed by a Set() of the key. The
+// traces draw from 1M keys with a Zipf(0.99) popularity, one plain and one with a scan of 50K keys seen only once
+// after every 100K accesses, as a batch job walking a table would do.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "concurrent_lru_cache/concurrent_lru_cache.h"
+
+namespace {
+
+const int kKeys = 1000000;
+const int kAccesses = 2000000;
+const int kScanEvery = 100000;
+const int kScanLength = 50000;
+
+class Random {
+public:
+    double NextDouble() {
+        this->state_ = this->state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<double>(this->state_ >> 11) / static_cast<double>(uint64_t(1) << 53);
+    }
+
+private:
+    uint64_t state_ = 3;
+};
+
+// key i is drawn with a probability proportional to 1 / (i + 1)^0.99
+std::vector<int> ZipfTrace(bool with_scans) {
+    std::vector<double> cdf(kKeys);
+    double sum = 0;
+    for (int i = 0; i < kKeys; ++i) {
+        sum += 1.0 / std::pow(i + 1, 0.99);
+        cdf[i] = sum;
+    }
+    Random random;
+    int scan_key = kKeys;
+    std::vector<int> trace;
+    trace.reserve(kAccesses + (with_scans ? kAccesses / kScanEvery * kScanLength : 0));
+    for (int i = 0; i < kAccesses; ++i) {
+        if (with_scans && i % kScanEvery == kScanEvery - 1) {
+            for (int j = 0; j < kScanLength; ++j) {
+                trace.push_back(scan_key++);
+            }
+        }
+        double r = random.NextDouble() * sum;
+        trace.push_back(static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(), r) - cdf.begin()));
+    }
+    return trace;
+}
+
+template <typename Cache>
+void Run(const char* name, const std::vector<int>& trace, int capacity) {
+    Cache cache(capacity);
+    int v = 0;
+    size_t hits = 0;
+    med_bench::Timer timer;
+    for (int key : trace) {
+        if (cache.Get(key, v)) {
+            ++hits;
+        } else {
+            cache.Set(key, key);
+        }
+    }
+    double ms = timer.ElapsedMs();
+    std::printf("%-10s %10d %12.2f %12.1f\n", name, capacity, 100.0 * hits / trace.size(), ms * 1e6 / trace.size());
+}
+
+void RunAll(const char* trace_name, const std::vector<int>& trace) {
+    std::printf("%s\n%-10s %10s %12s %12s\n", trace_name, "cache", "capacity", "hit rate %", "ns/access");
+    for (int capacity : {1000, 10000, 100000}) {
+        Run<med::LRUCache<int, int>>("LRU", trace, capacity);
+        Run<med::ClockCache<int, int>>("CLOCK", trace, capacity);
+        Run<med::TinyLFUCache<int, int>>("W-TinyLFU", trace, capacity);
+    }
+}
+
+}  // namespace
+
+int main() {
+    RunAll("zipf", ZipfTrace(false));
+    RunAll("zipf + scans", ZipfTrace(true));
+    return 0;
+}
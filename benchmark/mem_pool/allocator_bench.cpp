@@ -0,0 +1,130 @@
+// Container heavy request handling: every request fills a vector, an unordered_map of strings and a joined string,
+// then throws them away. Compares the default allocator with PoolAllocator over a per-request MemPool (freed in
+// bulk by Reset()) and over a SizeClassMemPool, and the std::pmr containers over PoolResource when built as C++17.
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "mem_pool/mem_pool.h"
+#include "mem_pool/pool_allocator.h"
+#include "mem_pool/size_class_mem_pool.h"
+
+namespace {
+
+const int kRequests = 100000;
+const int kItems = 32;
+
+template <template <typename> class Alloc, typename Factory>
+size_t HandleRequest(int request, Factory&& make) {
+    using String = std::basic_string<char, std::char_traits<char>, Alloc<char>>;
+    using Map = std::unordered_map<int, String, std::hash<int>, std::equal_to<int>,
+                                   Alloc<std::pair<const int, String>>>;
+    std::vector<int, Alloc<int>> ids(make.template Get<int>());
+    Map fields(kItems, std::hash<int>(), std::equal_to<int>(), make.template Get<std::pair<const int, String>>());
+    String joined(make.template Get<char>());
+    for (int i = 0; i < kItems; ++i) {
+        ids.push_back(request + i);
+        String value("field value of a request, long enough for the heap", make.template Get<char>());
+        value += static_cast<char>('a' + i % 26);
+        fields.emplace(i, std::move(value));
+    }
+    for (int id : ids) {
+        joined += fields.at(id - request);
+        joined += ',';
+    }
+    return joined.size();
+}
+
+template <typename T>
+using StdAlloc = std::allocator<T>;
+template <typename T>
+using ArenaAlloc = med::PoolAllocator<T, med::MemPool>;
+template <typename T>
+using FreeListAlloc = med::PoolAllocator<T, med::SizeClassMemPool>;
+
+class StdFactory {
+public:
+    template <typename T>
+    StdAlloc<T> Get() const {
+        return StdAlloc<T>();
+    }
+};
+
+template <typename Pool>
+class PoolFactory {
+public:
+    explicit PoolFactory(Pool& pool) : pool_(pool) {}
+    template <typename T>
+    med::PoolAllocator<T, Pool> Get() const {
+        return med::PoolAllocator<T, Pool>(this->pool_);
+    }
+
+private:
+    Pool& pool_;
+};
+
+template <typename F>
+double NsPerRequest(F&& handle) {
+    double ms = med_bench::BestOfMs(3, [&] {
+        size_t total = 0;
+        for (int request = 0; request < kRequests; ++request) {
+            total += handle(request);
+        }
+        med_bench::DoNotOptimize(total);
+    });
+    return ms * 1e6 / kRequests;
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%-28s %12s\n", "allocator", "ns/request");
+
+    double std_ns = NsPerRequest([](int request) { return HandleRequest<StdAlloc>(request, StdFactory()); });
+    std::printf("%-28s %12.0f\n", "std::allocator", std_ns);
+
+    med::MemPool arena;
+    double arena_ns = NsPerRequest([&](int request) {
+        size_t size = HandleRequest<ArenaAlloc>(request, PoolFactory<med::MemPool>(arena));
+        arena.Reset();
+        return size;
+    });
+    std::printf("%-28s %12.0f\n", "PoolAllocator<MemPool>", arena_ns);
+
+    med::SizeClassMemPool size_class;
+    double free_list_ns = NsPerRequest([&](int request) {
+        return HandleRequest<FreeListAlloc>(request, PoolFactory<med::SizeClassMemPool>(size_class));
+    });
+    std::printf("%-28s %12.0f\n", "PoolAllocator<SizeClass>", free_list_ns);
+
+#if __cplusplus > 201402L
+    med::MemPool pmr_arena;
+    med::PoolResource<> resource(pmr_arena);
+    double pmr_ns = NsPerRequest([&](int request) {
+        size_t size = 0;
+        {
+            std::pmr::vector<int> ids(&resource);
+            std::pmr::unordered_map<int, std::pmr::string> fields(kItems, &resource);
+            std::pmr::string joined(&resource);
+            for (int i = 0; i < kItems; ++i) {
+                ids.push_back(request + i);
+                std::pmr::string value("field value of a request, long enough for the heap", &resource);
+                value += static_cast<char>('a' + i % 26);
+                fields.emplace(i, std::move(value));
+            }
+            for (int id : ids) {
+                joined += fields.at(id - request);
+                joined += ',';
+            }
+            size = joined.size();
+        }
+        pmr_arena.Reset();
+        return size;
+    });
+    std::printf("%-28s %12.0f\n", "std::pmr over PoolResource", pmr_ns);
+#endif
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Parse and serialize per request: split a "key=value;..." line into fields and write them back out as JSON.
+// std::vector/std::string against ArenaVector/ArenaString over a MemPool that is Reset() after every request, and
+// ArenaVector of zero-copy views into the input.
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "mem_pool/arena_string.h"
+#include "mem_pool/arena_vector.h"
+#include "mem_pool/mem_pool.h"
+
+namespace {
+
+const int kRequests = 200000;
+const int kFields = 32;
+
+std::string MakeLine() {
+    std::string line;
+    for (int i = 0; i < kFields; ++i) {
+        line += "some_field_" + std::to_string(i) + "=a value of the field number " + std::to_string(i) + ";";
+    }
+    return line;
+}
+
+// calls on_field(key, key_size, value, value_size) for every field of line
+template <typename F>
+void Split(const std::string& line, F&& on_field) {
+    const char* pos = line.data();
+    const char* end = pos + line.size();
+    while (pos < end) {
+        const char* eq = static_cast<const char*>(std::memchr(pos, '=', end - pos));
+        const char* semi = static_cast<const char*>(std::memchr(eq, ';', end - eq));
+        on_field(pos, eq - pos, eq + 1, semi - eq - 1);
+        pos = semi + 1;
+    }
+}
+
+size_t StdRequest(const std::string& line) {
+    std::vector<std::pair<std::string, std::string>> fields;
+    Split(line, [&](const char* key, size_t key_size, const char* value, size_t value_size) {
+        fields.emplace_back(std::string(key, key_size), std::string(value, value_size));
+    });
+    std::string out = "{";
+    for (auto& field : fields) {
+        out += '"';
+        out += field.first;
+        out += "\":\"";
+        out += field.second;
+        out += "\",";
+    }
+    out.back() = '}';
+    return out.size();
+}
+
+size_t ArenaRequest(const std::string& line, med::MemPool& pool) {
+    size_t size = 0;
+    {
+        med::ArenaVector<std::pair<med::ArenaString, med::ArenaString>> fields(pool);
+        Split(line, [&](const char* key, size_t key_size, const char* value, size_t value_size) {
+            fields.EmplaceBack(med::ArenaString(pool, key, key_size), med::ArenaString(pool, value, value_size));
+        });
+        med::ArenaString out(pool, "{");
+        for (auto& field : fields) {
+            out += '"';
+            out += field.first;
+            out += "\":\"";
+            out += field.second;
+            out += "\",";
+        }
+        out[out.Size() - 1] = '}';
+        size = out.Size();
+    }
+    pool.Reset();
+    return size;
+}
+
+size_t ViewRequest(const std::string& line, med::MemPool& pool) {
+    size_t size = 0;
+    {
+        med::ArenaVector<std::pair<med::Span<const char>, med::Span<const char>>> fields(pool, kFields);
+        Split(line, [&](const char* key, size_t key_size, const char* value, size_t value_size) {
+            fields.EmplaceBack(med::Span<const char>(key, key_size), med::Span<const char>(value, value_size));
+        });
+        med::ArenaString out(pool, "{");
+        out.Reserve(line.size() + 4 * kFields);
+        for (auto& field : fields) {
+            out += '"';
+            out += field.first;
+            out += "\":\"";
+            out += field.second;
+            out += "\",";
+        }
+        out[out.Size() - 1] = '}';
+        size = out.Size();
+    }
+    pool.Reset();
+    return size;
+}
+
+template <typename F>
+double NsPerRequest(F&& request) {
+    double ms = med_bench::BestOfMs(3, [&] {
+        size_t total = 0;
+        for (int i = 0; i < kRequests; ++i) {
+            total += request();
+        }
+        med_bench::DoNotOptimize(total);
+    });
+    return ms * 1e6 / kRequests;
+}
+
+}  // namespace
+
+int main() {
+    std::string line = MakeLine();
+    med::MemPool pool(64 * 1024, 1024 * 1024, 0);
+    double std_ns = NsPerRequest([&] { return StdRequest(line); });
+    double arena_ns = NsPerRequest([&] { return ArenaRequest(line, pool); });
+    double view_ns = NsPerRequest([&] { return ViewRequest(line, pool); });
+
+    std::printf("%-30s %12s\n", "containers", "ns/request");
+    std::printf("%-30s %12.0f\n", "std::vector + std::string", std_ns);
+    std::printf("%-30s %12.0f\n", "ArenaVector + ArenaString", arena_ns);
+    std::printf("%-30s %12.0f\n", "ArenaVector of views", view_ns);
+    return 0;
+}
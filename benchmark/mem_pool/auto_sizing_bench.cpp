@@ -0,0 +1,62 @@
+// A request mix of mostly 4-32 KB requests with a 2 MB outlier now and then, served by one MemPool that is Reset()
+// after each request. Compares keeping the first block, merging all blocks into one, and auto sizing by a decaying
+// high-water mark: block appends per request and the memory the pool holds between requests.
+#include <cstdio>
+#include <cstdint>
+
+#include "benchmark/bench_util.h"
+#include "mem_pool/mem_pool.h"
+
+namespace {
+
+const int kRequests = 20000;
+
+class Random {
+public:
+    uint32_t Next() {
+        this->state_ = this->state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(this->state_ >> 33);
+    }
+
+private:
+    uint64_t state_ = 11;
+};
+
+size_t RequestBytes(Random& random) {
+    uint32_t r = random.Next();
+    return r % 500 == 0 ? 2 * 1024 * 1024 : 4 * 1024 + r % (28 * 1024);
+}
+
+enum class Policy { kKeepFirst, kMerge, kAutoSizing };
+
+void Run(const char* name, Policy policy) {
+    med::MemPool pool(4 * 1024, 1024 * 1024, 0);
+    if (policy == Policy::kAutoSizing) {
+        pool.EnableAutoSizing();
+    }
+    Random random;
+    double resident = 0;
+    med_bench::Timer timer;
+    for (int i = 0; i < kRequests; ++i) {
+        size_t bytes = RequestBytes(random);
+        for (size_t done = 0; done < bytes; done += 64) {
+            med_bench::DoNotOptimize(pool.Alloc(16 + random.Next() % 96));
+        }
+        pool.Reset(policy == Policy::kMerge);
+        resident += pool.AllocatedSize();
+    }
+    double ms = timer.ElapsedMs();
+    med::MemPoolStats stats = pool.Stats();
+    std::printf("%-12s %14.0f %16.2f %18.0f\n", name, ms * 1e6 / kRequests,
+                static_cast<double>(stats.block_appends) / kRequests, resident / kRequests / 1024);
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%-12s %14s %16s %18s\n", "policy", "ns/request", "appends/request", "resident KB (avg)");
+    Run("keep first", Policy::kKeepFirst);
+    Run("merge", Policy::kMerge);
+    Run("auto sizing", Policy::kAutoSizing);
+    return 0;
+}
@@ -0,0 +1,70 @@
+// Allocation throughput of many threads sharing one arena: ConcurrentMemPool with its per-thread blocks against a
+// MemPool behind a mutex and against malloc/free. Ideally the ConcurrentMemPool column grows linearly with the
+// threads.
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "mem_pool/concurrent_mem_pool.h"
+#include "mem_pool/mem_pool.h"
+
+namespace {
+
+const int kAllocsPerThread = 1000000;
+
+// million allocations per second of threads threads calling alloc(size) kAllocsPerThread times each
+template <typename Alloc, typename Reset>
+double Mops(size_t threads, Alloc&& alloc, Reset&& reset) {
+    double ms = med_bench::BestOfMs(3, [&] {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&] {
+                for (int i = 0; i < kAllocsPerThread; ++i) {
+                    med_bench::DoNotOptimize(alloc(16 + (i & 3) * 16));
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        reset();
+    });
+    return threads * kAllocsPerThread / ms / 1e3;
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%-8s %18s %18s %18s\n", "threads", "Concurrent Mops/s", "locked Mops/s", "malloc/free Mops/s");
+    for (size_t threads : med_bench::ThreadCounts()) {
+        med::ConcurrentMemPool concurrent;
+        double concurrent_mops =
+            Mops(threads, [&](size_t size) { return concurrent.Alloc(size); }, [&] { concurrent.Reset(); });
+
+        med::MemPool locked;
+        std::mutex mutex;
+        double locked_mops = Mops(
+            threads,
+            [&](size_t size) {
+                std::lock_guard<std::mutex> lock(mutex);
+                return locked.Alloc(size);
+            },
+            [&] { locked.Reset(); });
+
+        // malloc gets the matching free right away, its thread caches make that the cheapest case for it
+        double malloc_mops = Mops(
+            threads,
+            [&](size_t size) {
+                void* ptr = std::malloc(size);
+                med_bench::DoNotOptimize(ptr);
+                std::free(ptr);
+                return static_cast<char*>(nullptr);
+            },
+            [] {});
+        std::printf("%-8zu %18.1f %18.1f %18.1f\n", threads, concurrent_mops, locked_mops, malloc_mops);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+// Mixed lifetime churn: a window of live objects of random sizes where every step frees a random one and
+// allocates a new one. malloc/free and SizeClassMemPool give memory back, the plain MemPool arena can only grow
+// until Reset(), so its footprint is reported next to the time.
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "mem_pool/mem_pool.h"
+#include "mem_pool/size_class_mem_pool.h"
+
+namespace {
+
+const int kLive = 10000;
+const int kSteps = 2000000;
+
+struct Slot {
+    void* ptr;
+    size_t size;
+};
+
+class Random {
+public:
+    uint32_t Next() {
+        this->state_ = this->state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(this->state_ >> 33);
+    }
+
+private:
+    uint64_t state_ = 7;
+};
+
+// mostly small objects with an occasional bigger one
+size_t RandomSize(Random& random) {
+    uint32_t r = random.Next();
+    return r % 16 == 0 ? 256 + r % 2048 : 16 + r % 112;
+}
+
+template <class Alloc, class Free>
+double Churn(Alloc&& alloc, Free&& free) {
+    Random random;
+    std::vector<Slot> live(kLive);
+    for (auto& slot : live) {
+        slot.size = RandomSize(random);
+        slot.ptr = alloc(slot.size);
+    }
+    med_bench::Timer timer;
+    for (int i = 0; i < kSteps; ++i) {
+        Slot& slot = live[random.Next() % kLive];
+        free(slot.ptr, slot.size);
+        slot.size = RandomSize(random);
+        slot.ptr = alloc(slot.size);
+        static_cast<char*>(slot.ptr)[0] = 1;
+    }
+    double ms = timer.ElapsedMs();
+    for (auto& slot : live) {
+        free(slot.ptr, slot.size);
+    }
+    return ms * 1e6 / kSteps;
+}
+
+}  // namespace
+
+int main() {
+    double malloc_ns = Churn([](size_t size) { return std::malloc(size); }, [](void* ptr, size_t) { std::free(ptr); });
+
+    med::SizeClassMemPool size_class;
+    double size_class_ns = Churn([&](size_t size) { return size_class.Alloc(size); },
+                                 [&](void* ptr, size_t size) { size_class.Free(ptr, size); });
+
+    med::MemPool arena;
+    double arena_ns = Churn([&](size_t size) { return static_cast<void*>(arena.Alloc(size)); }, [](void*, size_t) {});
+
+    std::printf("%-18s %10s %14s\n", "allocator", "ns/step", "footprint KB");
+    std::printf("%-18s %10.1f %14s\n", "malloc/free", malloc_ns, "-");
+    std::printf("%-18s %10.1f %14zu\n", "SizeClassMemPool", size_class_ns, size_class.AllocatedSize() / 1024);
+    std::printf("%-18s %10.1f %14zu\n", "MemPool", arena_ns, arena.AllocatedSize() / 1024);
+    return 0;
+}
@@ -0,0 +1,62 @@
+// Per-task submission cost of a burst of tiny tasks: Enqueue in a loop against Execute, EnqueueBulk and
+// ExecuteBulk. The time covers submitting the burst and waiting for all of it to finish.
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "thread_pool/thread_pool.h"
+
+namespace {
+
+const int kTasks = 200000;
+
+void WaitFor(const std::atomic<int>& done, int expected) {
+    while (done.load() < expected) {
+        std::this_thread::yield();
+    }
+}
+
+}  // namespace
+
+int main() {
+    med::ThreadPool pool(std::max<size_t>(1, std::thread::hardware_concurrency()));
+    std::atomic<int> done{0};
+    std::vector<std::function<void()>> tasks(kTasks, [&done] { done.fetch_add(1, std::memory_order_relaxed); });
+
+    double enqueue_ms = med_bench::BestOfMs(5, [&] {
+        std::vector<std::future<void>> futures;
+        futures.reserve(kTasks);
+        for (auto& task : tasks) {
+            futures.push_back(pool.Enqueue(task));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+    });
+    double execute_ms = med_bench::BestOfMs(5, [&] {
+        int expected = done.load() + kTasks;
+        for (auto& task : tasks) {
+            pool.Execute(task);
+        }
+        WaitFor(done, expected);
+    });
+    double enqueue_bulk_ms = med_bench::BestOfMs(5, [&] {
+        for (auto& f : pool.EnqueueBulk(tasks.begin(), tasks.end())) {
+            f.get();
+        }
+    });
+    double execute_bulk_ms = med_bench::BestOfMs(5, [&] {
+        int expected = done.load() + kTasks;
+        pool.ExecuteBulk(tasks.begin(), tasks.end());
+        WaitFor(done, expected);
+    });
+
+    std::printf("%-14s %12s\n", "api", "ns/task");
+    std::printf("%-14s %12.1f\n", "Enqueue", enqueue_ms * 1e6 / kTasks);
+    std::printf("%-14s %12.1f\n", "Execute", execute_ms * 1e6 / kTasks);
+    std::printf("%-14s %12.1f\n", "EnqueueBulk", enqueue_bulk_ms * 1e6 / kTasks);
+    std::printf("%-14s %12.1f\n", "ExecuteBulk", execute_bulk_ms * 1e6 / kTasks);
+    return 0;
+}
@@ -0,0 +1,57 @@
+// Fan-out/fan-in of tiny tasks: a coroutine that awaits WhenAll over Tasks scheduled on the pool against
+// Enqueue followed by get() on every future. The coroutine version parks no thread while waiting.
+#include <cstdio>
+#include <future>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "thread_pool/coroutine.h"
+
+namespace {
+
+const int kFanOut = 10000;
+
+med::Task<int> Leaf(med::ThreadPool& pool, int v) {
+    co_await pool.Schedule();
+    co_return v & 1;
+}
+
+med::Task<int> FanOut(med::ThreadPool& pool, int n) {
+    std::vector<med::Task<int>> tasks;
+    tasks.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        tasks.push_back(Leaf(pool, i));
+    }
+    int sum = 0;
+    for (int v : co_await med::WhenAll(pool, std::move(tasks))) {
+        sum += v;
+    }
+    co_return sum;
+}
+
+int FanOutFutures(med::ThreadPool& pool, int n) {
+    std::vector<std::future<int>> futures;
+    futures.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        futures.push_back(pool.Enqueue([](int v) { return v & 1; }, i));
+    }
+    int sum = 0;
+    for (auto& f : futures) {
+        sum += f.get();
+    }
+    return sum;
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%-8s %16s %16s\n", "threads", "future ns/task", "co_await ns/task");
+    for (size_t threads : med_bench::ThreadCounts()) {
+        med::ThreadPool pool(threads);
+        double future_ms = med_bench::BestOfMs(5, [&] { med_bench::DoNotOptimize(FanOutFutures(pool, kFanOut)); });
+        double coroutine_ms =
+            med_bench::BestOfMs(5, [&] { med_bench::DoNotOptimize(med::SyncWait(FanOut(pool, kFanOut))); });
+        std::printf("%-8zu %16.1f %16.1f\n", threads, future_ms * 1e6 / kFanOut, coroutine_ms * 1e6 / kFanOut);
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+// Bursty load against a fixed pool sized for the peak and an elastic pool that starts with one worker: time to
+// drain a burst, and the workers still running once the pool went quiet between bursts.
+#include <cstdio>
+#include <future>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "thread_pool/thread_pool.h"
+
+namespace {
+
+const int kBursts = 20;
+const int kBurstTasks = 2000;
+
+void Spin(int us) {
+    med_bench::Timer timer;
+    while (timer.ElapsedMs() * 1000 < us) {
+    }
+}
+
+void Run(const char* name, const med::ThreadPoolOptions& options) {
+    med::ThreadPool pool(options);
+    double burst_ms = 0;
+    double idle_workers = 0;
+    for (int burst = 0; burst < kBursts; ++burst) {
+        med_bench::Timer timer;
+        std::vector<std::future<void>> futures;
+        futures.reserve(kBurstTasks);
+        for (int i = 0; i < kBurstTasks; ++i) {
+            futures.push_back(pool.Enqueue(Spin, 10));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+        burst_ms += timer.ElapsedMs();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        idle_workers += pool.Size();
+    }
+    med::ScalingCounters scaling = pool.Scaling();
+    std::printf("%-8s %12.2f %14.1f %10zu %10zu %10zu\n", name, burst_ms / kBursts, idle_workers / kBursts,
+                scaling.peak_workers, scaling.scale_up_on_backlog + scaling.scale_up_on_queue_wait,
+                scaling.retired_on_idle);
+}
+
+}  // namespace
+
+int main() {
+    size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    std::printf("%-8s %12s %14s %10s %10s %10s\n", "pool", "burst ms", "idle workers", "peak", "scale ups",
+                "retired");
+
+    med::ThreadPoolOptions fixed;
+    fixed.concurrency_num = threads;
+    Run("fixed", fixed);
+
+    med::ThreadPoolOptions elastic;
+    elastic.concurrency_num = 1;
+    elastic.elastic = true;
+    elastic.max_concurrency_num = threads;
+    elastic.idle_timeout_ms = 50;
+    Run("elastic", elastic);
+    return 0;
+}
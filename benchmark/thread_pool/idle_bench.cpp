@@ -0,0 +1,112 @@
+// Submit-to-start latency for an idle pool and cpu burnt while the pool has nothing to do, for a few idle
+// strategies, with the workers that polled the queue every 1 ms before parking was added as the baseline. Each
+// sample submits one task after a pause long enough for every worker to reach its parked state.
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <concurrentqueue/blockingconcurrentqueue.h>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "thread_pool/thread_pool.h"
+
+namespace {
+
+// the idle loop of ThreadPool before workers were parked: every worker waits on the queue for at most 1 ms, wakes
+// up and tries again
+class PollingPool {
+public:
+    explicit PollingPool(size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            this->workers_.emplace_back([this] {
+                while (!this->stop_) {
+                    std::function<void()> task;
+                    if (this->queue_.wait_dequeue_timed(task, 1000)) {
+                        task();
+                    }
+                }
+            });
+        }
+    }
+    ~PollingPool() {
+        this->stop_ = true;
+        for (auto& worker : this->workers_) {
+            worker.join();
+        }
+    }
+
+    template <class F>
+    std::future<decltype(std::declval<F>()())> Enqueue(F f) {
+        auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+        auto future = task->get_future();
+        this->queue_.enqueue([task] { (*task)(); });
+        return future;
+    }
+
+private:
+    std::atomic<bool> stop_{false};
+    moodycamel::BlockingConcurrentQueue<std::function<void()>> queue_;
+    std::vector<std::thread> workers_;
+};
+
+size_t WorkerNum() { return std::max<size_t>(1, std::thread::hardware_concurrency()); }
+
+double CpuMs() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+}
+
+template <class Pool>
+void Measure(const char* name, Pool& pool, size_t pause_us) {
+    std::vector<double> latency_us;
+    for (int i = 0; i < 500; ++i) {
+        std::this_thread::sleep_for(std::chrono::microseconds(pause_us));
+        auto submit = std::chrono::steady_clock::now();
+        auto start = pool.Enqueue([] { return std::chrono::steady_clock::now(); }).get();
+        latency_us.push_back(std::chrono::duration<double, std::micro>(start - submit).count());
+    }
+    std::sort(latency_us.begin(), latency_us.end());
+
+    double cpu_start = CpuMs();
+    med_bench::Timer timer;
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    double idle_cpu = (CpuMs() - cpu_start) / timer.ElapsedMs() * 100;
+
+    std::printf("%-14s %10zu %10.1f %10.1f %10.1f %12.2f\n", name, pause_us, latency_us[latency_us.size() / 2],
+                latency_us[latency_us.size() * 99 / 100], latency_us.back(), idle_cpu);
+}
+
+void Run(const char* name, size_t spin_count, size_t yield_count, size_t pause_us) {
+    med::ThreadPoolOptions options;
+    options.concurrency_num = WorkerNum();
+    options.spin_count = spin_count;
+    options.yield_count = yield_count;
+    med::ThreadPool pool(options);
+    Measure(name, pool, pause_us);
+}
+
+void RunPolling(size_t pause_us) {
+    PollingPool pool(WorkerNum());
+    Measure("poll 1ms", pool, pause_us);
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%-14s %10s %10s %10s %10s %12s\n", "strategy", "pause(us)", "p50(us)", "p99(us)", "max(us)",
+                "idle cpu(%)");
+    for (size_t pause_us : {20, 1000}) {
+        RunPolling(pause_us);
+        Run("park", 0, 0, pause_us);
+        Run("default", 128, 16, pause_us);
+        Run("spin-heavy", 1 << 16, 64, pause_us);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+// ParallelFor / ParallelReduce / ParallelTransform / ParallelSort against their serial std counterparts, for pools
+// of 1 to N workers (the calling thread joins in as well).
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "thread_pool/parallel_algorithm.h"
+
+namespace {
+
+const size_t kSize = 1 << 22;
+
+// cost grows with i, so equal sized chunks are imbalanced
+double Work(size_t i) {
+    double x = static_cast<double>(i);
+    for (size_t k = 0; k < (i & 63); ++k) {
+        x = std::sqrt(x + k);
+    }
+    return x;
+}
+
+}  // namespace
+
+int main() {
+    std::vector<double> input(kSize);
+    std::vector<double> output(kSize);
+    std::iota(input.begin(), input.end(), 0.0);
+    std::vector<int> unsorted(kSize);
+    std::mt19937 rng(42);
+    for (auto& v : unsorted) {
+        v = static_cast<int>(rng());
+    }
+
+    double serial_for = med_bench::BestOfMs(3, [&] {
+        for (size_t i = 0; i < kSize; ++i) {
+            output[i] = Work(i);
+        }
+    });
+    double serial_reduce = med_bench::BestOfMs(3, [&] {
+        med_bench::DoNotOptimize(std::accumulate(input.begin(), input.end(), 0.0));
+    });
+    double serial_transform = med_bench::BestOfMs(3, [&] {
+        std::transform(input.begin(), input.end(), output.begin(), [](double v) { return std::sqrt(v); });
+    });
+    double serial_sort = med_bench::BestOfMs(3, [&] {
+        std::vector<int> data = unsorted;
+        std::sort(data.begin(), data.end());
+    });
+
+    std::printf("%8s %12s %12s %12s %12s   (speedup over serial std)\n", "workers", "for", "reduce", "transform",
+                "sort");
+    for (size_t threads : med_bench::ThreadCounts()) {
+        med::ThreadPoolOptions options;
+        options.concurrency_num = threads;
+        options.work_stealing = true;
+        med::ThreadPool pool(options);
+
+        double parallel_for = med_bench::BestOfMs(3, [&] {
+            med::ParallelFor(pool, size_t(0), kSize, 0, [&](size_t i) { output[i] = Work(i); });
+        });
+        double parallel_reduce = med_bench::BestOfMs(3, [&] {
+            med_bench::DoNotOptimize(med::ParallelReduce(
+                pool, input.begin(), input.end(), 0, 0.0,
+                [](std::vector<double>::iterator b, std::vector<double>::iterator e, double init) {
+                    return std::accumulate(b, e, init);
+                },
+                [](double a, double b) { return a + b; }));
+        });
+        double parallel_transform = med_bench::BestOfMs(3, [&] {
+            med::ParallelTransform(pool, input.begin(), input.end(), output.begin(), 0,
+                                   [](double v) { return std::sqrt(v); });
+        });
+        double parallel_sort = med_bench::BestOfMs(3, [&] {
+            std::vector<int> data = unsorted;
+            med::ParallelSort(pool, data.begin(), data.end());
+        });
+        std::printf("%8zu %12.2f %12.2f %12.2f %12.2f\n", threads, serial_for / parallel_for,
+                    serial_reduce / parallel_reduce, serial_transform / parallel_transform, serial_sort / parallel_sort);
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+// Queue wait of latency sensitive requests while the pool is flooded with background work. The requests go
+// either to the same lane as the flood (a single FIFO, like before lanes existed) or to the high lane.
+#include <atomic>
+#include <cstdio>
+
+#include "benchmark/bench_util.h"
+#include "thread_pool/thread_pool.h"
+
+namespace {
+
+void Spin(int us) {
+    med_bench::Timer timer;
+    while (timer.ElapsedMs() * 1000 < us) {
+    }
+}
+
+void Run(const char* name, med::TaskPriority request_priority) {
+    med::ThreadPoolOptions options;
+    options.concurrency_num = std::max<size_t>(1, std::thread::hardware_concurrency());
+    options.track_queue_wait = true;
+    med::ThreadPool pool(options);
+
+    // background flood: plenty of 50us jobs queued ahead of every request
+    for (int i = 0; i < 20000; ++i) {
+        pool.ExecuteWithPriority(med::TaskPriority::kLow, [] { Spin(50); });
+    }
+    std::atomic<int> done{0};
+    for (int i = 0; i < 200; ++i) {
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        pool.ExecuteWithPriority(request_priority, [&done] {
+            Spin(5);
+            ++done;
+        });
+    }
+    while (done.load() < 200) {
+        std::this_thread::yield();
+    }
+
+    const med::LatencyHistogram& requests = pool.QueueWaitHistogram(request_priority);
+    std::printf("%-12s %12.1f %12.1f %12.1f\n", name, requests.Percentile(0.5) / 1e3, requests.Percentile(0.99) / 1e3,
+                requests.Max() / 1e3);
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%-12s %12s %12s %12s\n", "requests", "p50(us)", "p99(us)", "max(us)");
+    Run("same lane", med::TaskPriority::kLow);
+    Run("high lane", med::TaskPriority::kHigh);
+    return 0;
+}
@@ -0,0 +1,40 @@
+// Per-task cost of the instrumentation: a burst of tiny tasks with stats off, with collect_stats, and with
+// collect_stats plus tracing.
+#include <atomic>
+#include <cstdio>
+
+#include "benchmark/bench_util.h"
+#include "thread_pool/thread_pool.h"
+
+namespace {
+
+const int kTasks = 200000;
+
+double Run(bool collect_stats, bool trace) {
+    med::ThreadPoolOptions options;
+    options.concurrency_num = std::max<size_t>(1, std::thread::hardware_concurrency());
+    options.collect_stats = collect_stats;
+    options.trace = trace;
+    med::ThreadPool pool(options);
+    std::atomic<int> done{0};
+    double ms = med_bench::BestOfMs(5, [&] {
+        int expected = done.load() + kTasks;
+        for (int i = 0; i < kTasks; ++i) {
+            pool.Execute([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+        while (done.load() < expected) {
+            std::this_thread::yield();
+        }
+    });
+    return ms * 1e6 / kTasks;
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%-14s %12s\n", "mode", "ns/task");
+    std::printf("%-14s %12.1f\n", "off", Run(false, false));
+    std::printf("%-14s %12.1f\n", "collect_stats", Run(true, false));
+    std::printf("%-14s %12.1f\n", "stats+trace", Run(true, true));
+    return 0;
+}
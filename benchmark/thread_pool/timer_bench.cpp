@@ -0,0 +1,57 @@
+// Cost of the timing wheel behind ScheduleAfter: scheduling and cancelling a large number of pending timers, the
+// resident memory they take, and scheduling plus firing a batch of short timers.
+#include <sys/resource.h>
+
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
+#include "benchmark/bench_util.h"
+#include "thread_pool/thread_pool.h"
+
+namespace {
+
+const int kTimers = 500000;
+
+long MaxRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+}  // namespace
+
+int main() {
+    med::ThreadPool pool(std::max<size_t>(1, std::thread::hardware_concurrency()));
+    std::atomic<int> fired{0};
+    std::vector<med::TimerId> ids(kTimers);
+
+    long rss_before = MaxRssKb();
+    med_bench::Timer timer;
+    for (int i = 0; i < kTimers; ++i) {
+        ids[i] = pool.ScheduleAfter(std::chrono::seconds(60 + i % 3600), [&fired]() { ++fired; });
+    }
+    double schedule_ms = timer.ElapsedMs();
+    long rss_after = MaxRssKb();
+    timer.Reset();
+    for (auto id : ids) {
+        pool.CancelTimer(id);
+    }
+    double cancel_ms = timer.ElapsedMs();
+
+    timer.Reset();
+    for (int i = 0; i < kTimers; ++i) {
+        pool.ScheduleAfter(std::chrono::microseconds(i % 50000), [&fired]() { ++fired; });
+    }
+    while (fired.load() < kTimers) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double fire_ms = timer.ElapsedMs();
+
+    std::printf("%-22s %12s\n", "operation", "ns/timer");
+    std::printf("%-22s %12.1f\n", "ScheduleAfter", schedule_ms * 1e6 / kTimers);
+    std::printf("%-22s %12.1f\n", "CancelTimer", cancel_ms * 1e6 / kTimers);
+    std::printf("%-22s %12.1f\n", "schedule+fire (<50ms)", fire_ms * 1e6 / kTimers);
+    std::printf("pending timer memory: %.1f bytes/timer\n", (rss_after - rss_before) * 1024.0 / kTimers);
+    return 0;
+}
@@ -0,0 +1,53 @@
+// Fine-grained task throughput: a handful of root tasks each spawn many tiny child tasks from inside the pool.
+// With the shared queue every spawn and every pop hits the same queue; with work stealing children stay on the
+// spawning worker's deque and only idle workers touch other deques.
+#include <atomic>
+#include <cstdio>
+
+#include "benchmark/bench_util.h"
+#include "thread_pool/thread_pool.h"
+
+namespace {
+
+const int kRoots = 64;
+const int kChildren = 4096;
+
+double Run(size_t threads, bool work_stealing) {
+    med::ThreadPoolOptions options;
+    options.concurrency_num = threads;
+    options.work_stealing = work_stealing;
+    med::ThreadPool pool(options);
+
+    return med_bench::BestOfMs(3, [&pool] {
+        std::atomic<int> remaining{kRoots * kChildren};
+        for (int r = 0; r < kRoots; ++r) {
+            pool.Enqueue([&pool, &remaining] {
+                for (int c = 0; c < kChildren; ++c) {
+                    pool.Enqueue([&remaining, c] {
+                        volatile int x = c;
+                        for (int i = 0; i < 64; ++i) {
+                            x = x * 31 + i;
+                        }
+                        remaining.fetch_sub(1, std::memory_order_relaxed);
+                    });
+                }
+            });
+        }
+        while (remaining.load() > 0) {
+            std::this_thread::yield();
+        }
+    });
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%8s %16s %16s\n", "threads", "shared Mtask/s", "stealing Mtask/s");
+    for (size_t threads : med_bench::ThreadCounts()) {
+        double total = static_cast<double>(kRoots) * kChildren;
+        double shared_ms = Run(threads, false);
+        double stealing_ms = Run(threads, true);
+        std::printf("%8zu %16.2f %16.2f\n", threads, total / shared_ms / 1000, total / stealing_ms / 1000);
+    }
+    return 0;
+}
@@ -1,7 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
 #include <functional>
+#include <iterator>
 #include <list>
+#include <memory>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -105,7 +113,657 @@ private:
     std::unordered_map<_Key, typename std::list<value_type<_Key, _T>>::iterator, _Hash> index_;
 };
 
-template <typename _Key, typename _T, bool enable_ttl = false, typename _Hash = std::hash<_Key>>
+// LRUCache laid out in two flat arrays allocated up front: a slab of entries, linked into LRU order by 32 bit
+// indices, and an open addressing index of (slot, hash) pairs, probed linearly and kept free of tombstones by
+// shifting entries back on erase. Nothing is allocated after construction, an entry costs its key, value and 12
+// bytes plus 11 to 22 bytes of index, and a lookup touches one index line and one entry instead of chasing a hash
+// node and a list node. _Key and _T have to be default constructible.
+template <class _Key, class _T, bool enable_ttl = false, typename _Hash = std::hash<_Key>>
+class FlatLRUCache {
+public:
+    FlatLRUCache(int capacity) : capacity_(capacity), ttl_(0) {
+        static_assert(!enable_ttl, "FlatLRUCache(int) is available when enable_ttl=false");
+        this->init();
+    }
+    FlatLRUCache(int capacity, int ttl) : capacity_(capacity), ttl_(ttl) { this->init(); }
+
+    FlatLRUCache(FlatLRUCache&& other) {
+        this->capacity_ = other.capacity_;
+        this->ttl_ = other.ttl_;
+        this->size_ = other.size_;
+        this->used_ = other.used_;
+        this->head_ = other.head_;
+        this->free_ = other.free_;
+        this->shift_ = other.shift_;
+        this->mask_ = other.mask_;
+        this->entries_ = std::move(other.entries_);
+        this->buckets_ = std::move(other.buckets_);
+    }
+
+    void Set(const _Key& k, const _T& v) { this->Set(k, _T(v)); }
+
+    void Set(const _Key& k, _T&& v) {
+        if (this->capacity_ <= 0) {
+            return;
+        }
+        uint32_t hash = this->HashOf(k);
+        size_t pos = this->Find(k, hash);
+        if (this->buckets_[pos].slot_ != kNil) {
+            uint32_t slot = this->buckets_[pos].slot_;
+            this->entries_[slot].value_ = std::forward<_T>(v);
+            this->MoveToFront(slot);
+            return;
+        }
+        uint32_t slot = kNil;
+        if (this->size_ == static_cast<uint32_t>(this->capacity_)) {
+            // the least recently used entry goes, its slot takes the new one
+            slot = this->entries_[this->head_].prev_;
+            this->Erase(slot);
+            pos = this->Find(k, hash);
+        } else if (this->free_ != kNil) {
+            slot = this->free_;
+            this->free_ = this->entries_[slot].next_;
+        } else {
+            slot = this->used_++;
+        }
+        Entry& entry = this->entries_[slot];
+        entry.key_ = k;
+        entry.value_ = std::forward<_T>(v);
+        entry.expire_at_ = enable_ttl ? time(nullptr) + this->ttl_ : 0;
+        this->buckets_[pos].slot_ = slot;
+        this->buckets_[pos].hash_ = hash;
+        this->LinkFront(slot);
+        ++this->size_;
+    }
+
+    bool Get(const _Key& k, _T& v) {
+        if (this->capacity_ <= 0) {
+            return false;
+        }
+        uint32_t slot = this->buckets_[this->Find(k, this->HashOf(k))].slot_;
+        if (slot == kNil) {
+            return false;
+        }
+        if (enable_ttl && this->entries_[slot].expire_at_ < time(nullptr)) {
+            this->Erase(slot);
+            this->entries_[slot].next_ = this->free_;
+            this->free_ = slot;
+            return false;
+        }
+        this->MoveToFront(slot);
+        v = this->entries_[slot].value_;
+        return true;
+    }
+
+    template <typename Iter>
+    void MGet(Iter first, Iter last, std::unordered_map<_Key, _T>& kv_map) {
+        kv_map.clear();
+        _T v;
+        for (auto it = first; it != last; ++it) {
+            if (this->Get(*it, v)) {
+                kv_map.emplace(*it, v);
+            }
+        }
+    }
+
+    void MSet(const std::unordered_map<_Key, _T>& kv_map) {
+        for (auto&& p : kv_map) {
+            this->Set(p.first, p.second);
+        }
+    }
+
+private:
+    static const uint32_t kNil = ~uint32_t(0);
+
+    class Entry {
+    public:
+        _Key key_;
+        _T value_;
+        int expire_at_ = 0;
+        uint32_t prev_ = kNil;
+        uint32_t next_ = kNil;
+    };
+
+    // the high bits of the hash pick the home bucket, all 32 of them are kept to skip key compares and to find the
+    // home bucket again when shifting
+    class Bucket {
+    public:
+        uint32_t slot_ = kNil;
+        uint32_t hash_ = 0;
+    };
+
+    void init() {
+        if (this->capacity_ <= 0) {
+            return;
+        }
+        // a load factor of at most 3/4 keeps probe sequences short
+        size_t bucket_num = 2;
+        this->shift_ = 31;
+        while (bucket_num * 3 < static_cast<size_t>(this->capacity_) * 4) {
+            bucket_num *= 2;
+            --this->shift_;
+        }
+        this->mask_ = bucket_num - 1;
+        this->entries_.reset(new Entry[this->capacity_]);
+        this->buckets_.reset(new Bucket[bucket_num]);
+    }
+
+    // fibonacci hashing spreads identity hashes like std::hash<int> over the whole table
+    uint32_t HashOf(const _Key& k) const {
+        return static_cast<uint32_t>((static_cast<uint64_t>(_Hash()(k)) * 0x9E3779B97F4A7C15ULL) >> 32);
+    }
+
+    size_t Home(uint32_t hash) const { return hash >> this->shift_; }
+
+    // the bucket holding k, or the empty bucket ending its probe sequence
+    size_t Find(const _Key& k, uint32_t hash) const {
+        size_t pos = this->Home(hash);
+        for (;;) {
+            const Bucket& bucket = this->buckets_[pos];
+            if (bucket.slot_ == kNil || (bucket.hash_ == hash && this->entries_[bucket.slot_].key_ == k)) {
+                return pos;
+            }
+            pos = (pos + 1) & this->mask_;
+        }
+    }
+
+    // drops the entry in slot from the index and the LRU list, the slot itself is left to the caller
+    void Erase(uint32_t slot) {
+        Entry& entry = this->entries_[slot];
+        size_t hole = this->Find(entry.key_, this->HashOf(entry.key_));
+        // move later entries of the probe sequence back into the hole unless that would put them before their home
+        for (size_t pos = (hole + 1) & this->mask_; this->buckets_[pos].slot_ != kNil; pos = (pos + 1) & this->mask_) {
+            size_t home = this->Home(this->buckets_[pos].hash_);
+            if (((pos - home) & this->mask_) >= ((pos - hole) & this->mask_)) {
+                this->buckets_[hole] = this->buckets_[pos];
+                hole = pos;
+            }
+        }
+        this->buckets_[hole].slot_ = kNil;
+        this->Unlink(slot);
+        --this->size_;
+    }
+
+    // the list is circular, head_ is the most recently used entry and its prev_ the least recently used one
+    void LinkFront(uint32_t slot) {
+        Entry& entry = this->entries_[slot];
+        if (this->head_ == kNil) {
+            entry.prev_ = slot;
+            entry.next_ = slot;
+        } else {
+            Entry& head = this->entries_[this->head_];
+            entry.prev_ = head.prev_;
+            entry.next_ = this->head_;
+            this->entries_[head.prev_].next_ = slot;
+            head.prev_ = slot;
+        }
+        this->head_ = slot;
+    }
+
+    void Unlink(uint32_t slot) {
+        Entry& entry = this->entries_[slot];
+        if (entry.next_ == slot) {
+            this->head_ = kNil;
+            return;
+        }
+        this->entries_[entry.prev_].next_ = entry.next_;
+        this->entries_[entry.next_].prev_ = entry.prev_;
+        if (this->head_ == slot) {
+            this->head_ = entry.next_;
+        }
+    }
+
+    void MoveToFront(uint32_t slot) {
+        if (this->head_ != slot) {
+            this->Unlink(slot);
+            this->LinkFront(slot);
+        }
+    }
+
+private:
+    int capacity_ = 0;
+    int ttl_ = 0;
+    uint32_t size_ = 0;
+    // slots below used_ have held an entry, the ones freed by expiry are chained through next_ from free_
+    uint32_t used_ = 0;
+    uint32_t head_ = kNil;
+    uint32_t free_ = kNil;
+    int shift_ = 31;
+    size_t mask_ = 0;
+    std::unique_ptr<Entry[]> entries_;
+    std::unique_ptr<Bucket[]> buckets_;
+};
+
+// A CLOCK cache with the interface of LRUCache. A hit only sets the reference bit of its entry, so any number of
+// Get() calls may run at once as long as no Set() runs; eviction sweeps a hand over the entries, clearing reference
+// bits and taking the first entry that was not referenced since the hand last passed it (its second chance).
+// _Key and _T have to be default constructible.
+template <class _Key, class _T, bool enable_ttl = false, typename _Hash = std::hash<_Key>>
+class ClockCache {
+public:
+    ClockCache(int capacity) : capacity_(capacity), ttl_(0) {
+        static_assert(!enable_ttl, "ClockCache(int) is available when enable_ttl=false");
+        this->init();
+    }
+    ClockCache(int capacity, int ttl) : capacity_(capacity), ttl_(ttl) { this->init(); }
+
+    ClockCache(ClockCache&& other) {
+        this->capacity_ = other.capacity_;
+        this->ttl_ = other.ttl_;
+        this->size_ = other.size_;
+        this->hand_ = other.hand_;
+        this->slots_ = std::move(other.slots_);
+        this->index_ = std::move(other.index_);
+    }
+
+    void Set(const _Key& k, const _T& v) { this->Set(k, _T(v)); }
+
+    void Set(const _Key& k, _T&& v) {
+        if (this->capacity_ <= 0) {
+            return;
+        }
+        int expire_at = enable_ttl ? time(nullptr) + this->ttl_ : 0;
+        auto it = this->index_.find(k);
+        if (it != this->index_.end()) {
+            Slot& slot = this->slots_[it->second];
+            slot.value_ = std::forward<_T>(v);
+            slot.expire_at_ = expire_at;
+            slot.referenced_.store(true, std::memory_order_relaxed);
+            return;
+        }
+        int index = this->size_ < this->capacity_ ? this->size_++ : this->Evict();
+        Slot& slot = this->slots_[index];
+        slot.key_ = k;
+        slot.value_ = std::forward<_T>(v);
+        slot.expire_at_ = expire_at;
+        slot.referenced_.store(false, std::memory_order_relaxed);
+        this->index_.emplace(k, index);
+    }
+
+    // may run concurrently with other Get() calls, an expired entry is left for Set() to evict
+    bool Get(const _Key& k, _T& v) const {
+        auto it = this->index_.find(k);
+        if (it == this->index_.end()) {
+            return false;
+        }
+        const Slot& slot = this->slots_[it->second];
+        if (enable_ttl && slot.expire_at_ < time(nullptr)) {
+            return false;
+        }
+        // skipping the store when the bit is set keeps hot entries from bouncing their cache line between readers
+        if (!slot.referenced_.load(std::memory_order_relaxed)) {
+            slot.referenced_.store(true, std::memory_order_relaxed);
+        }
+        v = slot.value_;
+        return true;
+    }
+
+    template <typename Iter>
+    void MGet(Iter first, Iter last, std::unordered_map<_Key, _T>& kv_map) const {
+        kv_map.clear();
+        _T v;
+        for (auto it = first; it != last; ++it) {
+            if (this->Get(*it, v)) {
+                kv_map.emplace(*it, v);
+            }
+        }
+    }
+
+    void MSet(const std::unordered_map<_Key, _T>& kv_map) {
+        for (auto&& p : kv_map) {
+            this->Set(p.first, p.second);
+        }
+    }
+
+private:
+    class Slot {
+    public:
+        _Key key_;
+        _T value_;
+        int expire_at_ = 0;
+        mutable std::atomic<bool> referenced_{false};
+    };
+
+    void init() {
+        if (this->capacity_ > 0) {
+            this->slots_.reset(new Slot[this->capacity_]);
+            this->index_.reserve(this->capacity_);
+        }
+    }
+
+    // frees the slot under the hand that is expired or was not referenced since the last sweep
+    int Evict() {
+        int now = enable_ttl ? time(nullptr) : 0;
+        for (;;) {
+            int index = this->hand_;
+            this->hand_ = (this->hand_ + 1) % this->capacity_;
+            Slot& slot = this->slots_[index];
+            if (slot.referenced_.load(std::memory_order_relaxed) && !(enable_ttl && slot.expire_at_ < now)) {
+                slot.referenced_.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            this->index_.erase(slot.key_);
+            return index;
+        }
+    }
+
+private:
+    int capacity_ = 0;
+    int ttl_ = 0;
+    int size_ = 0;
+    int hand_ = 0;
+    std::unique_ptr<Slot[]> slots_;
+    std::unordered_map<_Key, int, _Hash> index_;
+};
+
+// Estimates how often keys were seen with a count-min sketch of 4 bit counters, four per key, in a table of about
+// four counters per cached entry. After 10 increments per entry all counters are halved, so that keys which were hot
+// a while ago fade out and the counts follow the recent popularity.
+template <typename _Key, typename _Hash = std::hash<_Key>>
+class FrequencySketch {
+public:
+    explicit FrequencySketch(int capacity) {
+        size_t entries = capacity > 0 ? static_cast<size_t>(capacity) : 1;
+        size_t counters = 16;
+        while (counters < entries * 4) {
+            counters *= 2;
+        }
+        this->mask_ = counters - 1;
+        this->table_.assign(counters / 16, 0);
+        this->sample_size_ = entries * 10;
+    }
+
+    // counters are only raised where they hold the minimum, which keeps keys that share counters with hot ones from
+    // being overestimated as much
+    void Increment(const _Key& k) {
+        size_t index[kDepth];
+        this->Indexes(k, index);
+        uint64_t min = this->Min(index);
+        if (min == kMaxCount) {
+            return;
+        }
+        for (int i = 0; i < kDepth; ++i) {
+            if (this->Count(index[i]) == min && !this->Repeats(index, i)) {
+                this->table_[index[i] >> 4] += uint64_t(1) << ((index[i] & 15) * 4);
+            }
+        }
+        if (++this->additions_ >= this->sample_size_) {
+            this->Age();
+        }
+    }
+
+    int Frequency(const _Key& k) const {
+        size_t index[kDepth];
+        this->Indexes(k, index);
+        return static_cast<int>(this->Min(index));
+    }
+
+private:
+    static const int kDepth = 4;
+    static const uint64_t kMaxCount = 15;
+
+    // double hashing over one well mixed 64 bit hash
+    void Indexes(const _Key& k, size_t* index) const {
+        uint64_t h = static_cast<uint64_t>(_Hash()(k));
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+        h ^= h >> 31;
+        uint64_t step = (h >> 32) | 1;
+        for (int i = 0; i < kDepth; ++i) {
+            index[i] = static_cast<size_t>(h + i * step) & this->mask_;
+        }
+    }
+
+    bool Repeats(const size_t* index, int i) const {
+        for (int j = 0; j < i; ++j) {
+            if (index[j] == index[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t Count(size_t index) const { return (this->table_[index >> 4] >> ((index & 15) * 4)) & kMaxCount; }
+
+    uint64_t Min(const size_t* index) const {
+        uint64_t min = kMaxCount;
+        for (int i = 0; i < kDepth; ++i) {
+            min = std::min(min, this->Count(index[i]));
+        }
+        return min;
+    }
+
+    void Age() {
+        for (uint64_t& word : this->table_) {
+            word = (word >> 1) & 0x7777777777777777ULL;
+        }
+        this->additions_ /= 2;
+    }
+
+private:
+    size_t mask_ = 0;
+    size_t sample_size_ = 0;
+    size_t additions_ = 0;
+    std::vector<uint64_t> table_;
+};
+
+// W-TinyLFU with the interface of LRUCache. New entries go to a window LRU of 1% of the capacity; what falls out
+// of it only enters the main segmented LRU if its FrequencySketch estimate beats that of the main LRU's victim, so a
+// scan of keys seen once passes through the window without flushing the hot set. The main LRU keeps 80% of its room
+// for entries hit again since they entered it (protected), the rest are on probation and evicted first. Hits and
+// Set() calls count as accesses to a key, a miss does not, so that the Get() and Set() of a miss count once.
+template <class _Key, class _T, bool enable_ttl = false, typename _Hash = std::hash<_Key>>
+class TinyLFUCache {
+public:
+    TinyLFUCache(int capacity) : capacity_(capacity), ttl_(0), sketch_(capacity) {
+        static_assert(!enable_ttl, "TinyLFUCache(int) is available when enable_ttl=false");
+        this->init();
+    }
+    TinyLFUCache(int capacity, int ttl) : capacity_(capacity), ttl_(ttl), sketch_(capacity) { this->init(); }
+
+    TinyLFUCache(TinyLFUCache&&) = default;
+
+    void Set(const _Key& k, const _T& v) { this->Set(k, _T(v)); }
+
+    void Set(const _Key& k, _T&& v) {
+        if (this->capacity_ <= 0) {
+            return;
+        }
+        this->sketch_.Increment(k);
+        auto it = this->index_.find(k);
+        if (it != this->index_.end()) {
+            it->second->value_ = std::forward<_T>(v);
+            this->OnHit(it->second);
+            return;
+        }
+        int expire_at = enable_ttl ? time(nullptr) + this->ttl_ : 0;
+        this->window_.emplace_front(k, std::forward<_T>(v), expire_at, kWindow);
+        this->index_.emplace(k, this->window_.begin());
+        if (this->window_.size() > this->window_capacity_) {
+            auto candidate = std::prev(this->window_.end());
+            candidate->segment_ = kProbation;
+            this->probation_.splice(this->probation_.begin(), this->window_, candidate);
+            if (this->probation_.size() + this->protected_.size() > this->main_capacity_) {
+                this->Evict();
+            }
+        }
+    }
+
+    bool Get(const _Key& k, _T& v) {
+        if (this->capacity_ <= 0) {
+            return false;
+        }
+        auto it = this->index_.find(k);
+        if (it == this->index_.end()) {
+            return false;
+        }
+        if (enable_ttl && it->second->expire_at_ < time(nullptr)) {
+            this->List(it->second->segment_).erase(it->second);
+            this->index_.erase(it);
+            return false;
+        }
+        this->sketch_.Increment(k);
+        this->OnHit(it->second);
+        v = it->second->value_;
+        return true;
+    }
+
+    template <typename Iter>
+    void MGet(Iter first, Iter last, std::unordered_map<_Key, _T>& kv_map) {
+        kv_map.clear();
+        _T v;
+        for (auto it = first; it != last; ++it) {
+            if (this->Get(*it, v)) {
+                kv_map.emplace(*it, v);
+            }
+        }
+    }
+
+    void MSet(const std::unordered_map<_Key, _T>& kv_map) {
+        for (auto&& p : kv_map) {
+            this->Set(p.first, p.second);
+        }
+    }
+
+private:
+    enum Segment { kWindow, kProbation, kProtected };
+
+    class Entry : public value_type<_Key, _T> {
+    public:
+        template <typename _V>
+        Entry(const _Key& k, _V&& v, int expire_at, Segment segment)
+            : value_type<_Key, _T>(k, std::forward<_V>(v), expire_at), segment_(segment) {}
+
+        Segment segment_;
+    };
+    using EntryList = std::list<Entry>;
+
+    void init() {
+        if (this->capacity_ <= 0) {
+            return;
+        }
+        this->window_capacity_ = std::max(1, this->capacity_ / 100);
+        this->main_capacity_ = this->capacity_ - this->window_capacity_;
+        this->protected_capacity_ = this->main_capacity_ * 4 / 5;
+        this->index_.reserve(this->capacity_);
+    }
+
+    EntryList& List(Segment segment) {
+        return segment == kWindow ? this->window_ : segment == kProbation ? this->probation_ : this->protected_;
+    }
+
+    void OnHit(typename EntryList::iterator it) {
+        if (it->segment_ != kProbation) {
+            EntryList& list = this->List(it->segment_);
+            list.splice(list.begin(), list, it);
+            return;
+        }
+        it->segment_ = kProtected;
+        this->protected_.splice(this->protected_.begin(), this->probation_, it);
+        if (this->protected_.size() > this->protected_capacity_) {
+            auto demoted = std::prev(this->protected_.end());
+            demoted->segment_ = kProbation;
+            this->probation_.splice(this->probation_.begin(), this->protected_, demoted);
+        }
+    }
+
+    // the candidate that just left the window sits at the front of probation and the victim at its back, the less
+    // frequent of the two goes, ties keep the victim
+    void Evict() {
+        auto candidate = this->probation_.begin();
+        auto victim = std::prev(this->probation_.end());
+        auto evicted = candidate;
+        if (victim != candidate && this->sketch_.Frequency(candidate->key_) > this->sketch_.Frequency(victim->key_)) {
+            evicted = victim;
+        }
+        this->index_.erase(evicted->key_);
+        this->probation_.erase(evicted);
+    }
+
+private:
+    int capacity_ = 0;
+    int ttl_ = 0;
+    size_t window_capacity_ = 0;
+    size_t main_capacity_ = 0;
+    size_t protected_capacity_ = 0;
+    FrequencySketch<_Key, _Hash> sketch_;
+    EntryList window_;
+    EntryList probation_;
+    EntryList protected_;
+    std::unordered_map<_Key, typename EntryList::iterator, _Hash> index_;
+};
+
+// A reader-writer spin lock for short critical sections. Waiting writers keep new readers out, so a steady stream
+// of readers can not starve them.
+class SharedSpinLock {
+public:
+    void lock() {
+        uint32_t state = this->state_.load(std::memory_order_relaxed);
+        for (;;) {
+            if ((state & ~kWriterWaiting) == 0 &&
+                this->state_.compare_exchange_weak(state, kWriter, std::memory_order_acquire)) {
+                return;
+            }
+            if ((state & kWriterWaiting) == 0) {
+                this->state_.fetch_or(kWriterWaiting, std::memory_order_relaxed);
+            }
+            std::this_thread::yield();
+            state = this->state_.load(std::memory_order_relaxed);
+        }
+    }
+    void unlock() { this->state_.store(0, std::memory_order_release); }
+
+    void lock_shared() {
+        uint32_t state = this->state_.load(std::memory_order_relaxed);
+        for (;;) {
+            if ((state & (kWriter | kWriterWaiting)) == 0) {
+                if (this->state_.compare_exchange_weak(state, state + 1, std::memory_order_acquire)) {
+                    return;
+                }
+                continue;
+            }
+            std::this_thread::yield();
+            state = this->state_.load(std::memory_order_relaxed);
+        }
+    }
+    void unlock_shared() { this->state_.fetch_sub(1, std::memory_order_release); }
+
+private:
+    static const uint32_t kWriter = uint32_t(1) << 31;
+    static const uint32_t kWriterWaiting = uint32_t(1) << 30;
+
+    std::atomic<uint32_t> state_{0};
+    // the locks of neighbouring shards sit in one vector
+    char padding_[64 - sizeof(std::atomic<uint32_t>)];
+};
+
+template <typename _Mutex>
+class SharedLockGuard {
+public:
+    explicit SharedLockGuard(_Mutex& mutex) : mutex_(mutex) { this->mutex_.lock_shared(); }
+    ~SharedLockGuard() { this->mutex_.unlock_shared(); }
+
+    SharedLockGuard(const SharedLockGuard&) = delete;
+    SharedLockGuard& operator=(const SharedLockGuard&) = delete;
+
+private:
+    _Mutex& mutex_;
+};
+
+// how the shards of a ConcurrentLRUCache pick the entry to evict
+enum class EvictionPolicy {
+    // exact LRU, every hit moves its entry to the front under the exclusive shard lock
+    kLRU,
+    // CLOCK, a hit only sets a reference bit under a shared shard lock: reads of a hot shard no longer serialize
+    kClock,
+    // exact LRU like kLRU on the preallocated flat layout of FlatLRUCache
+    kFlatLRU,
+    // W-TinyLFU of TinyLFUCache, keys seen once can not push out the frequently used ones
+    kTinyLFU,
+};
+
+template <typename _Key, typename _T, bool enable_ttl = false, typename _Hash = std::hash<_Key>,
+          EvictionPolicy policy = EvictionPolicy::kLRU>
 class ConcurrentLRUCache {
 public:
     ConcurrentLRUCache(int capacity, int shard) : capacity_(capacity), shard_(shard), ttl_(0) {
@@ -120,14 +778,13 @@ public:
 
     void Set(const _Key& k, _T&& v) {
         int bucket_id = this->hash_(k) % this->shard_;
-        std::lock_guard<std::mutex> lock(this->mutex_list_[bucket_id]);
+        std::lock_guard<Mutex> lock(this->mutex_list_[bucket_id]);
         this->cache_list_[bucket_id].Set(k, std::forward<_T>(v));
     }
 
     bool Get(const _Key& k, _T& v) {
         int bucket_id = this->hash_(k) % this->shard_;
-        std::lock_guard<std::mutex> lock(this->mutex_list_[bucket_id]);
-        return this->cache_list_[bucket_id].Get(k, v);
+        return this->Get(bucket_id, k, v, std::integral_constant<bool, policy == EvictionPolicy::kClock>());
     }
 
     template <typename Iter>
@@ -148,8 +805,26 @@ public:
     }
 
 private:
+    using Shard = typename std::conditional<
+        policy == EvictionPolicy::kClock, ClockCache<_Key, _T, enable_ttl, _Hash>,
+        typename std::conditional<
+            policy == EvictionPolicy::kFlatLRU, FlatLRUCache<_Key, _T, enable_ttl, _Hash>,
+            typename std::conditional<policy == EvictionPolicy::kTinyLFU, TinyLFUCache<_Key, _T, enable_ttl, _Hash>,
+                                      LRUCache<_Key, _T, enable_ttl, _Hash>>::type>::type>::type;
+    using Mutex = typename std::conditional<policy == EvictionPolicy::kClock, SharedSpinLock, std::mutex>::type;
+
+    bool Get(int bucket_id, const _Key& k, _T& v, std::false_type) {
+        std::lock_guard<Mutex> lock(this->mutex_list_[bucket_id]);
+        return this->cache_list_[bucket_id].Get(k, v);
+    }
+
+    bool Get(int bucket_id, const _Key& k, _T& v, std::true_type) {
+        SharedLockGuard<Mutex> lock(this->mutex_list_[bucket_id]);
+        return this->cache_list_[bucket_id].Get(k, v);
+    }
+
     void init() {
-        std::vector<std::mutex>(this->shard_).swap(this->mutex_list_);
+        std::vector<Mutex>(this->shard_).swap(this->mutex_list_);
         this->cache_list_.reserve(this->shard_);
         int capacity_per_shard = this->capacity_ / this->shard_;
         int padding_num = this->capacity_ - capacity_per_shard * this->shard_;
@@ -168,8 +843,8 @@ private:
     int shard_ = 0;
     int ttl_ = 0;
 
-    std::vector<typename med::LRUCache<_Key, _T, enable_ttl, _Hash>> cache_list_;
-    std::vector<std::mutex> mutex_list_;
+    std::vector<Shard> cache_list_;
+    std::vector<Mutex> mutex_list_;
 };
 
 }  // namespace med
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#if __cplusplus > 201402L
+#include <string_view>
+#endif
+
+#include "mem_pool/arena_vector.h"
+#include "mem_pool/mem_pool.h"
+
+namespace med {
+
+// A growable, NUL terminated string in the memory of a MemPool, growing like ArenaVector. View() and Sub() hand out
+// parts of it without copying.
+class ArenaString {
+public:
+    explicit ArenaString(MemPool& pool) : chars_(pool) {}
+    ArenaString(MemPool& pool, const char* str, size_t n) : chars_(pool) { this->Append(str, n); }
+    ArenaString(MemPool& pool, const char* str) : chars_(pool) { this->Append(str); }
+    ArenaString(MemPool& pool, const std::string& str) : chars_(pool) { this->Append(str); }
+    ArenaString(MemPool& pool, Span<const char> str) : chars_(pool) { this->Append(str); }
+
+    ArenaString(ArenaString&&) = default;
+    ArenaString& operator=(ArenaString&&) = default;
+
+    // the terminating NUL is kept in the buffer but not counted
+    size_t Size() const { return this->chars_.Empty() ? 0 : this->chars_.Size() - 1; }
+    bool Empty() const { return this->Size() == 0; }
+    size_t Capacity() const { return this->chars_.Empty() ? 0 : this->chars_.Capacity() - 1; }
+    const char* Data() const { return this->chars_.Empty() ? "" : this->chars_.Data(); }
+    const char* CStr() const { return this->Data(); }
+    char operator[](size_t i) const { return this->chars_[i]; }
+    char& operator[](size_t i) { return this->chars_[i]; }
+    const char* begin() const { return this->Data(); }
+    const char* end() const { return this->Data() + this->Size(); }
+
+    Span<const char> View() const { return Span<const char>(this->Data(), this->Size()); }
+    // up to n chars starting at pos, clamped to the string
+    Span<const char> Sub(size_t pos, size_t n = static_cast<size_t>(-1)) const { return this->View().Sub(pos, n); }
+    std::string Str() const { return std::string(this->Data(), this->Size()); }
+#if __cplusplus > 201402L
+    operator std::string_view() const { return std::string_view(this->Data(), this->Size()); }
+#endif
+
+    void Reserve(size_t n) { this->chars_.Reserve(n + 1); }
+
+    ArenaString& Append(const char* str, size_t n) {
+        if (n == 0) {
+            return *this;
+        }
+        if (this->chars_.Empty()) {
+            this->chars_.Reserve(n + 1);
+        } else {
+            this->chars_.PopBack();
+        }
+        this->chars_.Append(str, str + n);
+        this->chars_.PushBack('\0');
+        return *this;
+    }
+    ArenaString& Append(const char* str) { return this->Append(str, std::strlen(str)); }
+    ArenaString& Append(const std::string& str) { return this->Append(str.data(), str.size()); }
+    ArenaString& Append(const ArenaString& str) { return this->Append(str.Data(), str.Size()); }
+    ArenaString& Append(Span<const char> str) { return this->Append(str.Data(), str.Size()); }
+
+    void PushBack(char c) {
+        if (!this->chars_.Empty()) {
+            this->chars_.Back() = c;
+        } else {
+            this->chars_.PushBack(c);
+        }
+        this->chars_.PushBack('\0');
+    }
+
+    template <typename T>
+    ArenaString& operator+=(const T& str) {
+        return this->Append(str);
+    }
+    ArenaString& operator+=(char c) {
+        this->PushBack(c);
+        return *this;
+    }
+
+    void Clear() { this->chars_.Clear(); }
+
+    bool Equals(const char* str, size_t n) const {
+        return this->Size() == n && std::memcmp(this->Data(), str, n) == 0;
+    }
+
+private:
+    ArenaVector<char> chars_;
+};
+
+inline bool operator==(const ArenaString& a, const ArenaString& b) { return a.Equals(b.Data(), b.Size()); }
+inline bool operator==(const ArenaString& a, const char* b) { return a.Equals(b, std::strlen(b)); }
+inline bool operator==(const ArenaString& a, const std::string& b) { return a.Equals(b.data(), b.size()); }
+inline bool operator!=(const ArenaString& a, const ArenaString& b) { return !(a == b); }
+inline bool operator!=(const ArenaString& a, const char* b) { return !(a == b); }
+inline bool operator!=(const ArenaString& a, const std::string& b) { return !(a == b); }
+
+}  // namespace med
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "mem_pool/mem_pool.h"
+
+namespace med {
+
+// A non owning view of n consecutive Ts, e.g. a slice of an ArenaVector handed on without copying it.
+template <typename T>
+class Span {
+public:
+    Span() = default;
+    Span(T* data, size_t size) : data_(data), size_(size) {}
+    template <typename U>
+    Span(const Span<U>& other) : data_(other.Data()), size_(other.Size()) {}
+
+    T* Data() const { return this->data_; }
+    size_t Size() const { return this->size_; }
+    bool Empty() const { return this->size_ == 0; }
+    T* begin() const { return this->data_; }
+    T* end() const { return this->data_ + this->size_; }
+    T& operator[](size_t i) const { return this->data_[i]; }
+
+    // up to count elements starting at offset, clamped to the view
+    Span Sub(size_t offset, size_t count = static_cast<size_t>(-1)) const {
+        offset = std::min(offset, this->size_);
+        return Span(this->data_ + offset, std::min(count, this->size_ - offset));
+    }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// A growable array in the memory of a MemPool. While its buffer is the latest allocation of the pool it grows in
+// place, otherwise it moves to a bigger buffer further up in the pool; it never touches the global heap. The old
+// buffers stay in the pool until its Reset(), so prefer Reserve() when the size is known and fill one container at
+// a time. The elements are destroyed with the vector, which has to go before the pool is reset.
+template <typename T>
+class ArenaVector {
+public:
+    explicit ArenaVector(MemPool& pool, size_t capacity = 0) : pool_(&pool) { this->Reserve(capacity); }
+    ArenaVector(MemPool& pool, std::initializer_list<T> values) : pool_(&pool) {
+        this->Reserve(values.size());
+        for (const T& value : values) {
+            this->PushBack(value);
+        }
+    }
+
+    ArenaVector(ArenaVector&& other) noexcept
+        : pool_(other.pool_), data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+    ArenaVector& operator=(ArenaVector&& other) noexcept {
+        if (this != &other) {
+            this->Clear();
+            this->pool_ = other.pool_;
+            this->data_ = other.data_;
+            this->size_ = other.size_;
+            this->capacity_ = other.capacity_;
+            other.data_ = nullptr;
+            other.size_ = 0;
+            other.capacity_ = 0;
+        }
+        return *this;
+    }
+    ArenaVector(const ArenaVector&) = delete;
+    ArenaVector& operator=(const ArenaVector&) = delete;
+
+    ~ArenaVector() { this->Clear(); }
+
+    size_t Size() const { return this->size_; }
+    size_t Capacity() const { return this->capacity_; }
+    bool Empty() const { return this->size_ == 0; }
+    T* Data() { return this->data_; }
+    const T* Data() const { return this->data_; }
+    T* begin() { return this->data_; }
+    T* end() { return this->data_ + this->size_; }
+    const T* begin() const { return this->data_; }
+    const T* end() const { return this->data_ + this->size_; }
+    T& operator[](size_t i) { return this->data_[i]; }
+    const T& operator[](size_t i) const { return this->data_[i]; }
+    T& At(size_t i) {
+        this->CheckIndex(i);
+        return this->data_[i];
+    }
+    const T& At(size_t i) const {
+        this->CheckIndex(i);
+        return this->data_[i];
+    }
+    T& Front() { return this->data_[0]; }
+    T& Back() { return this->data_[this->size_ - 1]; }
+    const T& Front() const { return this->data_[0]; }
+    const T& Back() const { return this->data_[this->size_ - 1]; }
+    MemPool& Pool() const { return *this->pool_; }
+
+    // a view of the elements, valid until the vector grows or goes away
+    Span<T> View() { return Span<T>(this->data_, this->size_); }
+    Span<const T> View() const { return Span<const T>(this->data_, this->size_); }
+
+    void Reserve(size_t capacity) {
+        if (capacity > this->capacity_) {
+            this->Relocate(capacity);
+        }
+    }
+
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        if (this->size_ == this->capacity_) {
+            this->Grow(this->size_ + 1);
+        }
+        T* slot = new (this->data_ + this->size_) T(std::forward<Args>(args)...);
+        ++this->size_;
+        return *slot;
+    }
+    void PushBack(const T& value) { this->EmplaceBack(value); }
+    void PushBack(T&& value) { this->EmplaceBack(std::move(value)); }
+
+    void PopBack() {
+        --this->size_;
+        this->data_[this->size_].~T();
+    }
+
+    template <typename InputIt>
+    void Append(InputIt first, InputIt last) {
+        this->Reserve(this->size_ + std::distance(first, last));
+        for (; first != last; ++first) {
+            new (this->data_ + this->size_) T(*first);
+            ++this->size_;
+        }
+    }
+
+    void Resize(size_t size) { this->ResizeWith(size); }
+    void Resize(size_t size, const T& value) { this->ResizeWith(size, value); }
+
+    void Clear() {
+        while (this->size_ > 0) {
+            this->PopBack();
+        }
+    }
+
+private:
+    static const size_t kMinCapacity = 8;
+
+    void CheckIndex(size_t i) const {
+        if (i >= this->size_) {
+            throw std::out_of_range("ArenaVector index out of range");
+        }
+    }
+
+    template <typename... Args>
+    void ResizeWith(size_t size, const Args&... args) {
+        if (size < this->size_) {
+            while (this->size_ > size) {
+                this->PopBack();
+            }
+            return;
+        }
+        this->Reserve(size);
+        while (this->size_ < size) {
+            new (this->data_ + this->size_) T(args...);
+            ++this->size_;
+        }
+    }
+
+    void Grow(size_t min_capacity) {
+        size_t capacity = std::max(this->capacity_ * 2, static_cast<size_t>(kMinCapacity));
+        this->Relocate(std::max(capacity, min_capacity));
+    }
+
+    void Relocate(size_t capacity) {
+        char* old_data = reinterpret_cast<char*>(this->data_);
+        if (old_data != nullptr && this->pool_->TryGrow(old_data, this->capacity_ * sizeof(T), capacity * sizeof(T))) {
+            this->capacity_ = capacity;
+            return;
+        }
+        T* data = reinterpret_cast<T*>(this->pool_->AllocAligned(capacity * sizeof(T), alignof(T)));
+        for (size_t i = 0; i < this->size_; ++i) {
+            new (data + i) T(std::move(this->data_[i]));
+            this->data_[i].~T();
+        }
+        this->data_ = data;
+        this->capacity_ = capacity;
+    }
+
+private:
+    MemPool* pool_;
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+}  // namespace med
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace med {
+
+// Where the blocks of a MemPool come from and go back to. Memory has to be aligned for every fundamental type, and
+// sources are shared between pools, so they have to be thread safe.
+class BlockSource {
+public:
+    virtual ~BlockSource() = default;
+
+    // size bytes, throws std::bad_alloc when there is no memory left
+    virtual void* Allocate(size_t size) = 0;
+    // memory from Allocate() of this source together with the size it was asked for
+    virtual void Deallocate(void* ptr, size_t size) = 0;
+};
+
+// plain malloc/free, what a pool uses when it is not given a source
+class MallocBlockSource : public BlockSource {
+public:
+    static MallocBlockSource* Instance() {
+        static MallocBlockSource source;
+        return &source;
+    }
+
+    void* Allocate(size_t size) override {
+        void* ptr = std::malloc(size == 0 ? 1 : size);
+        if (ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+    void Deallocate(void* ptr, size_t) override { std::free(ptr); }
+};
+
+// Keeps given back blocks, binned by their exact size, and hands them to the next Allocate() of that size, so pools
+// that are Reset() and refilled for every request, or many short lived pools sharing the cache, stop going to the
+// upstream after warm-up. At most max_cached_bytes are kept, the rest goes back to the upstream right away.
+class CachedBlockSource : public BlockSource {
+public:
+    explicit CachedBlockSource(size_t max_cached_bytes = 64 * 1024 * 1024, BlockSource* upstream = nullptr)
+        : max_cached_bytes_(max_cached_bytes), upstream_(upstream ? upstream : MallocBlockSource::Instance()) {}
+
+    CachedBlockSource(const CachedBlockSource&) = delete;
+    CachedBlockSource& operator=(const CachedBlockSource&) = delete;
+
+    ~CachedBlockSource() override { this->Trim(); }
+
+    void* Allocate(size_t size) override {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            auto it = this->free_.find(size);
+            if (it != this->free_.end() && !it->second.empty()) {
+                void* ptr = it->second.back();
+                it->second.pop_back();
+                this->cached_bytes_ -= size;
+                ++this->hits_;
+                return ptr;
+            }
+            ++this->misses_;
+        }
+        return this->upstream_->Allocate(size);
+    }
+
+    void Deallocate(void* ptr, size_t size) override {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            if (this->cached_bytes_ + size <= this->max_cached_bytes_) {
+                this->free_[size].push_back(ptr);
+                this->cached_bytes_ += size;
+                return;
+            }
+        }
+        this->upstream_->Deallocate(ptr, size);
+    }
+
+    // gives every cached block back to the upstream
+    void Trim() {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        for (auto& bin : this->free_) {
+            for (void* ptr : bin.second) {
+                this->upstream_->Deallocate(ptr, bin.first);
+            }
+            bin.second.clear();
+        }
+        this->cached_bytes_ = 0;
+    }
+
+    size_t CachedBytes() const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        return this->cached_bytes_;
+    }
+    // Allocate() calls served from the cache and passed on to the upstream
+    size_t Hits() const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        return this->hits_;
+    }
+    size_t Misses() const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        return this->misses_;
+    }
+
+private:
+    const size_t max_cached_bytes_;
+    BlockSource* upstream_;
+    mutable std::mutex mutex_;
+    std::unordered_map<size_t, std::vector<void*>> free_;
+    size_t cached_bytes_ = 0;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+// Blocks mapped straight from the kernel. Blocks of at least huge_page_threshold bytes are 2 MB aligned and advised
+// to use transparent huge pages, which saves TLB misses on big arenas. Given back mappings are kept for reuse up to
+// max_cached_bytes, with their pages released by MADV_DONTNEED, so they cost address space but no memory.
+class MmapBlockSource : public BlockSource {
+public:
+    static const size_t kHugePageSize = 2 * 1024 * 1024;
+
+    explicit MmapBlockSource(size_t max_cached_bytes = 64 * 1024 * 1024, size_t huge_page_threshold = kHugePageSize)
+        : max_cached_bytes_(max_cached_bytes),
+          huge_page_threshold_(huge_page_threshold),
+          page_size_(static_cast<size_t>(sysconf(_SC_PAGESIZE))) {}
+
+    MmapBlockSource(const MmapBlockSource&) = delete;
+    MmapBlockSource& operator=(const MmapBlockSource&) = delete;
+
+    ~MmapBlockSource() override {
+        for (auto& bin : this->free_) {
+            for (void* ptr : bin.second) {
+                munmap(ptr, bin.first);
+            }
+        }
+    }
+
+    void* Allocate(size_t size) override {
+        size_t length = this->MappedLength(size);
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            auto it = this->free_.find(length);
+            if (it != this->free_.end() && !it->second.empty()) {
+                void* ptr = it->second.back();
+                it->second.pop_back();
+                this->cached_bytes_ -= length;
+                return ptr;
+            }
+        }
+        return length >= this->huge_page_threshold_ ? MapHuge(length) : Map(length);
+    }
+
+    void Deallocate(void* ptr, size_t size) override {
+        size_t length = this->MappedLength(size);
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            if (this->cached_bytes_ + length <= this->max_cached_bytes_) {
+                madvise(ptr, length, MADV_DONTNEED);
+                this->free_[length].push_back(ptr);
+                this->cached_bytes_ += length;
+                return;
+            }
+        }
+        munmap(ptr, length);
+    }
+
+    // bytes of address space kept for reuse, none of it backed by memory
+    size_t CachedBytes() const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        return this->cached_bytes_;
+    }
+
+private:
+    size_t MappedLength(size_t size) const {
+        size_t unit = this->page_size_;
+        if (size >= this->huge_page_threshold_) {
+            unit = kHugePageSize;
+        }
+        return (std::max<size_t>(size, 1) + unit - 1) / unit * unit;
+    }
+
+    static void* Map(size_t length) {
+        void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    // huge pages need a 2 MB aligned range: map one huge page more and cut off what sticks out on both ends
+    static void* MapHuge(size_t length) {
+        char* raw = static_cast<char*>(Map(length + kHugePageSize));
+        uintptr_t addr = reinterpret_cast<uintptr_t>(raw);
+        char* start = raw + ((kHugePageSize - addr % kHugePageSize) % kHugePageSize);
+        if (start > raw) {
+            munmap(raw, start - raw);
+        }
+        size_t tail = raw + length + kHugePageSize - (start + length);
+        if (tail > 0) {
+            munmap(start + length, tail);
+        }
+#if defined(MADV_HUGEPAGE)
+        madvise(start, length, MADV_HUGEPAGE);
+#endif
+        return start;
+    }
+
+private:
+    const size_t max_cached_bytes_;
+    const size_t huge_page_threshold_;
+    const size_t page_size_;
+    mutable std::mutex mutex_;
+    std::unordered_map<size_t, std::vector<void*>> free_;
+    size_t cached_bytes_ = 0;
+};
+#endif
+
+}  // namespace med
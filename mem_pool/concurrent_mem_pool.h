@@ -0,0 +1,247 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mem_pool/mem_pool.h"
+
+namespace med {
+
+// A MemPool that many threads allocate from at once, e.g. the workers of a ThreadPool sharing the allocations of a
+// request. Every thread bump allocates from a block of its own cache without any synchronization; only taking a
+// new block from the shared upstream locks a mutex. Reset(), Used() and AllocatedSize() cover all threads.
+//
+// Reset() and destruction must not overlap with allocations. Objects of one thread are destroyed latest first on
+// Reset(), there is no order between threads. The cache of an exited thread stays with the pool until a thread
+// with the same id comes along.
+class ConcurrentMemPool {
+public:
+    // blocks come from source, malloc when it is null
+    explicit ConcurrentMemPool(size_t block_size = 64 * 1024, BlockSource* source = nullptr)
+        : block_size_(block_size), source_(source), id_(NextId()) {}
+
+    ConcurrentMemPool(const ConcurrentMemPool&) = delete;
+    ConcurrentMemPool& operator=(const ConcurrentMemPool&) = delete;
+
+    ~ConcurrentMemPool() { this->Reset(); }
+
+    template <typename T, typename... Args>
+    T* Create(Args&&... args) {
+        ThreadCache* cache = this->LocalCache();
+        internal::DestructorRecord* record = this->AllocRecord<T>(cache);
+        T* ptr = reinterpret_cast<T*>(this->AllocAligned(cache, sizeof(T), alignof(T)));
+        new (ptr) T(std::forward<Args>(args)...);
+        PushRecord(cache, record, ptr, 1);
+        return ptr;
+    }
+
+    // every element is constructed from the same args, so they are never moved from
+    template <typename T, typename... Args>
+    T* CreateArray(size_t n, Args&&... args) {
+        ThreadCache* cache = this->LocalCache();
+        internal::DestructorRecord* record = this->AllocRecord<T>(cache);
+        T* ptr = reinterpret_cast<T*>(this->AllocAligned(cache, sizeof(T) * n, alignof(T)));
+        size_t i = 0;
+        try {
+            for (; i < n; ++i) {
+                new (ptr + i) T(args...);
+            }
+        } catch (...) {
+            DestroyObjects<T>(ptr, i);
+            throw;
+        }
+        PushRecord(cache, record, ptr, n);
+        return ptr;
+    }
+
+    char* Alloc(size_t size) { return this->AllocAligned(this->LocalCache(), size, 1); }
+    char* AllocAligned(size_t size, size_t align) { return this->AllocAligned(this->LocalCache(), size, align); }
+
+    // runs the destructors and gives every block back to the upstream, where the threads pick them up again
+    void Reset() {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        for (auto& cache : this->caches_) {
+            while (cache->destructors_ != nullptr) {
+                internal::DestructorRecord* record = cache->destructors_;
+                cache->destructors_ = record->prev;
+                record->destroy(record->ptr, record->n);
+            }
+            cache->block_ = nullptr;
+            cache->used_.store(0, std::memory_order_relaxed);
+        }
+        this->free_blocks_.clear();
+        for (auto& block : this->blocks_) {
+            block.Reset();
+            this->free_blocks_.push_back(&block);
+        }
+        size_t large = 0;
+        for (auto& block : this->large_blocks_) {
+            large += block.Capacity();
+        }
+        this->large_blocks_.clear();
+        this->allocated_.fetch_sub(large, std::memory_order_relaxed);
+    }
+
+    // bytes handed out by all threads since the last Reset(), without alignment padding
+    size_t Used() const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        size_t used = 0;
+        for (auto& cache : this->caches_) {
+            used += cache->used_.load(std::memory_order_relaxed);
+        }
+        return used;
+    }
+
+    // bytes of all blocks taken from the system
+    size_t AllocatedSize() const { return this->allocated_.load(std::memory_order_relaxed); }
+
+    // thread caches created so far
+    size_t ThreadNum() const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        return this->caches_.size();
+    }
+
+private:
+    // requests above this share of a block get a block of their own and leave the current one alone
+    static const size_t kLargeDivisor = 4;
+    static const size_t kLocalEntryNum = 4;
+
+    class ThreadCache {
+    public:
+        explicit ThreadCache(std::thread::id owner) : owner_(owner) {}
+
+        std::thread::id owner_;
+        MemBlock* block_ = nullptr;
+        internal::DestructorRecord* destructors_ = nullptr;
+        // written by the owner only, read by Used()
+        std::atomic<size_t> used_{0};
+        // keeps the caches of two threads off the same cache line
+        char padding_[64];
+    };
+
+    // the caches of the pools a thread used last, found without locking
+    struct LocalEntry {
+        uint64_t pool_id;
+        ThreadCache* cache;
+    };
+
+    static uint64_t NextId() {
+        static std::atomic<uint64_t> next_id{1};
+        return next_id.fetch_add(1);
+    }
+
+    static LocalEntry* LocalEntries() {
+        static thread_local LocalEntry entries[kLocalEntryNum] = {};
+        return entries;
+    }
+
+    ThreadCache* LocalCache() {
+        LocalEntry* entries = LocalEntries();
+        for (size_t i = 0; i < kLocalEntryNum; ++i) {
+            if (entries[i].pool_id == this->id_) {
+                return entries[i].cache;
+            }
+        }
+        ThreadCache* cache = this->FindCache();
+        // the least recently registered entry makes room
+        for (size_t i = kLocalEntryNum - 1; i > 0; --i) {
+            entries[i] = entries[i - 1];
+        }
+        entries[0].pool_id = this->id_;
+        entries[0].cache = cache;
+        return cache;
+    }
+
+    // the cache of the calling thread, it may have been pushed out of the local entries by other pools
+    ThreadCache* FindCache() {
+        std::thread::id self = std::this_thread::get_id();
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        for (auto& cache : this->caches_) {
+            if (cache->owner_ == self) {
+                return cache.get();
+            }
+        }
+        this->caches_.emplace_back(new ThreadCache(self));
+        return this->caches_.back().get();
+    }
+
+    char* AllocAligned(ThreadCache* cache, size_t size, size_t align) {
+        char* data = cache->block_ != nullptr ? cache->block_->Alloc(size, align) : nullptr;
+        if (data == nullptr) {
+            data = this->Refill(cache, size, align);
+        }
+        cache->used_.store(cache->used_.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+        return data;
+    }
+
+    char* Refill(ThreadCache* cache, size_t size, size_t align) {
+        size_t required = size + (align > alignof(std::max_align_t) ? align - 1 : 0);
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if (required > this->block_size_ / kLargeDivisor) {
+            this->large_blocks_.emplace_back(required, this->source_);
+            this->allocated_.fetch_add(required, std::memory_order_relaxed);
+            return this->large_blocks_.back().Alloc(size, align);
+        }
+        if (this->free_blocks_.empty()) {
+            this->blocks_.emplace_back(this->block_size_, this->source_);
+            this->allocated_.fetch_add(this->block_size_, std::memory_order_relaxed);
+            cache->block_ = &this->blocks_.back();
+        } else {
+            cache->block_ = this->free_blocks_.back();
+            this->free_blocks_.pop_back();
+        }
+        return cache->block_->Alloc(size, align);
+    }
+
+    template <typename T>
+    static void DestroyObjects(void* ptr, size_t n) {
+        T* objects = static_cast<T*>(ptr);
+        for (size_t i = 0; i < n; ++i) {
+            objects[i].~T();
+        }
+    }
+
+    template <typename T>
+    internal::DestructorRecord* AllocRecord(ThreadCache* cache) {
+        if (std::is_trivially_destructible<T>::value) {
+            return nullptr;
+        }
+        return reinterpret_cast<internal::DestructorRecord*>(this->AllocAligned(
+            cache, sizeof(internal::DestructorRecord), alignof(internal::DestructorRecord)));
+    }
+
+    template <typename T>
+    static void PushRecord(ThreadCache* cache, internal::DestructorRecord* record, T* ptr, size_t n) {
+        if (record == nullptr) {
+            return;
+        }
+        record->destroy = &DestroyObjects<T>;
+        record->ptr = ptr;
+        record->n = n;
+        record->prev = cache->destructors_;
+        cache->destructors_ = record;
+    }
+
+private:
+    const size_t block_size_;
+    BlockSource* const source_;
+    // tells the pool apart from an earlier one at the same address in the local entries
+    const uint64_t id_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadCache>> caches_;
+    std::list<MemBlock> blocks_;
+    std::vector<MemBlock*> free_blocks_;
+    std::list<MemBlock> large_blocks_;
+    std::atomic<size_t> allocated_{0};
+};
+
+}  // namespace med
@@ -1,23 +1,45 @@
 #pragma once
 
-#include <functional>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <list>
+#include <new>
 #include <type_traits>
+#include <utility>
+
+#include "mem_pool/block_source.h"
 
 namespace med {
+namespace internal {
+
+// a destructor to run on MemPool::Reset(), stored in the arena itself and chained to the one recorded before it
+struct DestructorRecord {
+    void (*destroy)(void* ptr, size_t n);
+    void* ptr;
+    size_t n;
+    DestructorRecord* prev;
+};
+
+}  // namespace internal
+
 class MemBlock {
 public:
-    MemBlock(size_t capacity) : capacity_(capacity) { data_ = new char[capacity]; }
+    MemBlock(size_t capacity, BlockSource* source = nullptr)
+        : capacity_(capacity), source_(source ? source : MallocBlockSource::Instance()) {
+        data_ = static_cast<char*>(source_->Allocate(capacity));
+    }
     ~MemBlock() {
         if (data_) {
-            delete[] data_;
+            source_->Deallocate(data_, capacity_);
         }
     }
     size_t Idle() const { return capacity_ - used_; }
     size_t Size() const { return used_; }
     size_t Capacity() const { return capacity_; }
     void Reset() { used_ = 0; }
+    void Rewind(size_t used) { used_ = used; }
     char* Alloc(size_t size) {
         if (size <= Idle()) {
             char* ptr = data_ + used_;
@@ -27,62 +49,142 @@ public:
             return nullptr;
         }
     }
+    // takes extra bytes more for the allocation ending at end, if it is the latest one of the block and they fit
+    bool Extend(const char* end, size_t extra) {
+        if (end != data_ + used_ || extra > Idle()) {
+            return false;
+        }
+        used_ += extra;
+        return true;
+    }
+    // align has to be a power of two, the padding in front of the object counts as used
+    char* Alloc(size_t size, size_t align) {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(data_ + used_);
+        size_t padding = ((addr + align - 1) & ~(uintptr_t(align) - 1)) - addr;
+        if (padding > Idle() || size > Idle() - padding) {
+            return nullptr;
+        }
+        used_ += padding;
+        return Alloc(size);
+    }
     char* Raw() { return data_; }
     const char* Raw() const { return data_; }
 
 private:
     size_t used_ = 0;
     size_t capacity_ = 0;
+    BlockSource* source_ = nullptr;
     char* data_ = nullptr;
 };
 
+// a point to roll a MemPool back to, see MemPool::Mark()
+struct MemPoolMark {
+    size_t block_num;
+    size_t used;
+    internal::DestructorRecord* destructors;
+};
+
+// counters of a MemPool since its construction or ResetStats()
+class MemPoolStats {
+public:
+    // Alloc/Create calls and the bytes they asked for
+    size_t allocations = 0;
+    size_t allocated_bytes = 0;
+    size_t block_appends = 0;
+    // idle bytes at the end of blocks that were left behind for a new one
+    size_t wasted_bytes = 0;
+    size_t resets = 0;
+    // the most bytes in use, as seen by Reset(), Rollback() and Stats()
+    size_t peak_used = 0;
+    // the decaying high-water mark auto sizing works with, see MemPool::EnableAutoSizing()
+    size_t high_water = 0;
+};
+
 class MemPool {
 public:
     MemPool(size_t init_capacity = 0) : MemPool(4 * 1024, 1024 * 1024, init_capacity) {}
-    MemPool(size_t block_size, size_t max_block_size, size_t init_capacity)
-        : block_size_(block_size), max_block_size_(max_block_size), init_capacity_(init_capacity) {
+    // blocks come from source, malloc when it is null. share a CachedBlockSource between pools that are Reset() for
+    // every request to stop going to malloc for their blocks, or use an MmapBlockSource for huge pages.
+    MemPool(size_t block_size, size_t max_block_size, size_t init_capacity, BlockSource* source = nullptr)
+        : block_size_(block_size),
+          max_block_size_(max_block_size),
+          init_capacity_(init_capacity),
+          min_first_block_(init_capacity > 0 ? init_capacity : block_size),
+          source_(source) {
         if (init_capacity > 0) {
-            blocks_.emplace_back(init_capacity);
+            blocks_.emplace_back(init_capacity, source_);
         } else {
-            blocks_.emplace_back(block_size_);
+            blocks_.emplace_back(block_size_, source_);
         }
     }
 
+    // the destructor of a T that is not trivially destructible runs on Reset(), its record takes a few bytes of the
+    // arena and no extra heap allocation
     template <typename T, typename... Args>
-    T* Create(Args... args) {
-        char* data = this->blocks_.back().Alloc(sizeof(T));
-        if (data != nullptr) {
-            T* ptr = reinterpret_cast<T*>(data);
-            new (ptr) T(args...);
-            if (!std::is_arithmetic<T>::value) {
-                this->destructors_.push_back([ptr] { ptr->~T(); });
-            }
-            return ptr;
-        }
-        this->AppendBlock(sizeof(T));
-        return this->Create<T>();
+    T* Create(Args&&... args) {
+        internal::DestructorRecord* record = this->AllocRecord<T>();
+        T* ptr = reinterpret_cast<T*>(this->AllocAligned(sizeof(T), alignof(T)));
+        new (ptr) T(std::forward<Args>(args)...);
+        this->PushRecord(record, ptr, 1);
+        return ptr;
     }
 
+    // every element is constructed from the same args, so they are never moved from
     template <typename T, typename... Args>
-    T* CreateArray(size_t n, Args... args) {
-        size_t required_size = sizeof(T) * n;
-        char* data = this->blocks_.back().Alloc(required_size);
-        if (data != nullptr) {
-            T* ptr = reinterpret_cast<T*>(data);
-            for (size_t i = 0; i < n; ++i) {
+    T* CreateArray(size_t n, Args&&... args) {
+        internal::DestructorRecord* record = this->AllocRecord<T>();
+        T* ptr = reinterpret_cast<T*>(this->AllocAligned(sizeof(T) * n, alignof(T)));
+        size_t i = 0;
+        try {
+            for (; i < n; ++i) {
                 new (ptr + i) T(args...);
             }
-            if (!std::is_arithmetic<T>::value) {
-                this->destructors_.push_back([ptr, n] {
-                    for (size_t i = 0; i < n; ++i) {
-                        ptr[i].~T();
-                    }
-                });
-            }
-            return ptr;
+        } catch (...) {
+            DestroyObjects<T>(ptr, i);
+            throw;
+        }
+        this->PushRecord(record, ptr, n);
+        return ptr;
+    }
+
+    // raw bytes from the current block without any alignment, a new block is appended when they do not fit
+    char* Alloc(size_t size) { return this->AllocAligned(size, 1); }
+
+    // size bytes starting at a multiple of align (a power of two), e.g. 64 for a cache line or 32 for AVX
+    char* AllocAligned(size_t size, size_t align) {
+        ++this->stats_.allocations;
+        this->stats_.allocated_bytes += size;
+        return this->AllocFromBlocks(size, align);
+    }
+
+    // grows the allocation of old_size bytes at ptr to new_size bytes where it is. only possible while nothing was
+    // allocated after it and its block has room left, returns false otherwise.
+    bool TryGrow(char* ptr, size_t old_size, size_t new_size) {
+        if (new_size <= old_size) {
+            return true;
         }
-        this->AppendBlock(required_size);
-        return this->CreateArray<T>(n);
+        if (!this->blocks_.back().Extend(ptr + old_size, new_size - old_size)) {
+            return false;
+        }
+        this->stats_.allocated_bytes += new_size - old_size;
+        return true;
+    }
+
+    // remembers the current state, so everything allocated after it can be undone by Rollback(). marks nest, and
+    // a mark taken before a Reset() or a Rollback() to an earlier mark must not be used anymore.
+    MemPoolMark Mark() const {
+        return MemPoolMark{this->blocks_.size(), this->blocks_.back().Size(), this->destructors_};
+    }
+
+    // destroys the objects created since mark, latest first, and rewinds the arena to it: blocks appended since then
+    // go back to the block source and the next allocations reuse the memory of the mark's block
+    void Rollback(const MemPoolMark& mark) {
+        this->stats_.peak_used = std::max(this->stats_.peak_used, this->Used());
+        this->RunDestructors(mark.destructors);
+        while (this->blocks_.size() > mark.block_num) {
+            this->blocks_.pop_back();
+        }
+        this->blocks_.back().Rewind(mark.used);
     }
 
     size_t Used() const {
@@ -101,11 +203,37 @@ public:
         return size;
     }
 
+    MemPoolStats Stats() const {
+        MemPoolStats stats = this->stats_;
+        stats.peak_used = std::max(stats.peak_used, this->Used());
+        return stats;
+    }
+
+    void ResetStats() {
+        this->stats_ = MemPoolStats();
+        this->high_water_ = 0;
+    }
+
+    // Sizes the first block on every Reset() by what recent cycles used instead of by merge_blocks: the high-water
+    // mark is the larger of this cycle's usage and the previous mark times decay (0 <= decay < 1). The first block
+    // is made bigger when the mark outgrew it, so the next cycle needs fewer block appends, and smaller when it is
+    // more than twice the mark, so one outlier does not pin a huge block for good.
+    void EnableAutoSizing(double decay = 0.9) {
+        this->auto_sizing_ = true;
+        this->decay_ = decay;
+    }
 
     void Reset(bool merge_blocks = false) {
-        while (!this->destructors_.empty()) {
-            this->destructors_.back()();
-            this->destructors_.pop_back();
+        this->RunDestructors(nullptr);
+
+        size_t used = this->Used();
+        ++this->stats_.resets;
+        this->stats_.peak_used = std::max(this->stats_.peak_used, used);
+        this->high_water_ = std::max(static_cast<double>(used), this->high_water_ * this->decay_);
+        this->stats_.high_water = static_cast<size_t>(this->high_water_);
+        if (this->auto_sizing_) {
+            this->ResizeFirstBlock();
+            return;
         }
 
         if (!merge_blocks) {
@@ -119,7 +247,7 @@ public:
         size_t total_size = this->AllocatedSize();
         if (total_size > this->init_capacity_) {
             this->blocks_.clear();
-            this->blocks_.emplace_back(total_size);
+            this->blocks_.emplace_back(total_size, this->source_);
         } else {
             while (this->blocks_.size() > 1) {
                 this->blocks_.pop_back();
@@ -128,12 +256,86 @@ public:
         }
     }
 
-    ~MemPool() { this->Reset(); }
+    // only destroys the objects, a destructor must neither allocate a resized first block nor count a reset
+    ~MemPool() { this->RunDestructors(nullptr); }
 
 private:
+    static const size_t kBlockAlign = alignof(std::max_align_t);
+    // auto sizing rounds the first block up to this
+    static const size_t kSizeUnit = 1024;
+
+    template <typename T>
+    static void DestroyObjects(void* ptr, size_t n) {
+        T* objects = static_cast<T*>(ptr);
+        for (size_t i = 0; i < n; ++i) {
+            objects[i].~T();
+        }
+    }
+
+    // taken before the object is constructed, so a failing allocation can not leave it without its destructor
+    template <typename T>
+    internal::DestructorRecord* AllocRecord() {
+        if (std::is_trivially_destructible<T>::value) {
+            return nullptr;
+        }
+        // records are bookkeeping of the pool and stay out of the allocation stats
+        return reinterpret_cast<internal::DestructorRecord*>(
+            this->AllocFromBlocks(sizeof(internal::DestructorRecord), alignof(internal::DestructorRecord)));
+    }
+
+    char* AllocFromBlocks(size_t size, size_t align) {
+        char* data = this->blocks_.back().Alloc(size, align);
+        if (data == nullptr) {
+            // new blocks are aligned for every fundamental type already
+            size_t padding = align > kBlockAlign ? align - 1 : 0;
+            this->AppendBlock(size + padding);
+            data = this->blocks_.back().Alloc(size, align);
+        }
+        return data;
+    }
+
+    // destroys the objects created after the record until, latest first. the records live in the blocks and are
+    // gone once the blocks are reset.
+    void RunDestructors(internal::DestructorRecord* until) {
+        while (this->destructors_ != until) {
+            internal::DestructorRecord* record = this->destructors_;
+            this->destructors_ = record->prev;
+            record->destroy(record->ptr, record->n);
+        }
+    }
+
+    template <typename T>
+    void PushRecord(internal::DestructorRecord* record, T* ptr, size_t n) {
+        if (record == nullptr) {
+            return;
+        }
+        record->destroy = &DestroyObjects<T>;
+        record->ptr = ptr;
+        record->n = n;
+        record->prev = this->destructors_;
+        this->destructors_ = record;
+    }
+
+    void ResizeFirstBlock() {
+        size_t target = (this->stats_.high_water + kSizeUnit - 1) / kSizeUnit * kSizeUnit;
+        target = std::max(this->min_first_block_, target);
+        size_t capacity = this->blocks_.front().Capacity();
+        if (capacity >= target && capacity <= target * 2) {
+            while (this->blocks_.size() > 1) {
+                this->blocks_.pop_back();
+            }
+            this->blocks_.back().Reset();
+            return;
+        }
+        this->blocks_.clear();
+        this->blocks_.emplace_back(target, this->source_);
+    }
+
     void AppendBlock(size_t required_size) {
+        ++this->stats_.block_appends;
+        this->stats_.wasted_bytes += this->blocks_.back().Idle();
         if (required_size > this->max_block_size_) {
-            this->blocks_.emplace_back(required_size);
+            this->blocks_.emplace_back(required_size, this->source_);
             return;
         }
         do {
@@ -146,14 +348,50 @@ private:
                 break;
             }
         } while (0);
-        this->blocks_.emplace_back(this->block_size_);
+        this->blocks_.emplace_back(this->block_size_, this->source_);
     }
 
 private:
     size_t block_size_;
     size_t max_block_size_;
     size_t init_capacity_;
+    size_t min_first_block_;
+    BlockSource* source_;
+    MemPoolStats stats_;
+    bool auto_sizing_ = false;
+    double decay_ = 0.9;
+    double high_water_ = 0;
     std::list<MemBlock> blocks_;
-    std::list<std::function<void()>> destructors_;
+    internal::DestructorRecord* destructors_ = nullptr;
+};
+
+// Rolls a MemPool back to where it was when the scope started, unless Commit() keeps what was allocated. For
+// scratch work like trying the alternatives of a parser one after the other in the same memory:
+//
+//     for (auto& alternative : alternatives) {
+//         med::MemPoolScope scope(pool);
+//         if (Parse(alternative, pool)) {
+//             scope.Commit();
+//             break;
+//         }
+//     }
+class MemPoolScope {
+public:
+    explicit MemPoolScope(MemPool& pool) : pool_(pool), mark_(pool.Mark()) {}
+    ~MemPoolScope() {
+        if (!this->committed_) {
+            this->pool_.Rollback(this->mark_);
+        }
+    }
+
+    MemPoolScope(const MemPoolScope&) = delete;
+    MemPoolScope& operator=(const MemPoolScope&) = delete;
+
+    void Commit() { this->committed_ = true; }
+
+private:
+    MemPool& pool_;
+    MemPoolMark mark_;
+    bool committed_ = false;
 };
-}  // namespace med
\ No newline at end of file
+}  // namespace med
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+#if __cplusplus > 201402L
+#include <memory_resource>
+#endif
+
+#include "mem_pool/mem_pool.h"
+#include "mem_pool/size_class_mem_pool.h"
+
+namespace med {
+namespace internal {
+
+// a MemPool only gives memory back on Reset(), SizeClassMemPool puts it on the free list of its size class
+inline void* PoolAllocate(MemPool& pool, size_t size, size_t align) { return pool.AllocAligned(size, align); }
+inline void PoolDeallocate(MemPool&, void*, size_t) {}
+
+inline void* PoolAllocate(SizeClassMemPool& pool, size_t size, size_t align) {
+    if (align > SizeClassMemPool::kSmallStep) {
+        throw std::bad_alloc();
+    }
+    return pool.Alloc(size);
+}
+inline void PoolDeallocate(SizeClassMemPool& pool, void* ptr, size_t size) { pool.Free(ptr, size); }
+
+}  // namespace internal
+
+// A C++11 allocator handing out memory of a MemPool (or a SizeClassMemPool), so the containers of a request can
+// live in the pool of that request and go away with its Reset(). The pool has to outlive every container using
+// it, and Reset() must not happen while one of them still holds memory. Allocators of the same pool compare equal.
+//
+//     med::MemPool pool;
+//     std::vector<int, med::PoolAllocator<int>> ids(med::PoolAllocator<int>(pool));
+template <typename T, typename Pool = MemPool>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = PoolAllocator<U, Pool>;
+    };
+
+    explicit PoolAllocator(Pool& pool) noexcept : pool_(&pool) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U, Pool>& other) noexcept : pool_(other.GetPool()) {}
+
+    T* allocate(size_t n) {
+        if (n > static_cast<size_t>(-1) / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(internal::PoolAllocate(*this->pool_, n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept { internal::PoolDeallocate(*this->pool_, ptr, n * sizeof(T)); }
+
+    Pool* GetPool() const noexcept { return this->pool_; }
+
+private:
+    Pool* pool_;
+};
+
+template <typename T, typename U, typename Pool>
+bool operator==(const PoolAllocator<T, Pool>& a, const PoolAllocator<U, Pool>& b) noexcept {
+    return a.GetPool() == b.GetPool();
+}
+
+template <typename T, typename U, typename Pool>
+bool operator!=(const PoolAllocator<T, Pool>& a, const PoolAllocator<U, Pool>& b) noexcept {
+    return a.GetPool() != b.GetPool();
+}
+
+#if __cplusplus > 201402L
+// The std::pmr flavour of PoolAllocator: a memory_resource over a pool for std::pmr containers. Two resources
+// are only equal when they are the same object, as std::pmr expects.
+template <typename Pool = MemPool>
+class PoolResource : public std::pmr::memory_resource {
+public:
+    explicit PoolResource(Pool& pool) noexcept : pool_(&pool) {}
+
+    Pool* GetPool() const noexcept { return this->pool_; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t align) override {
+        return internal::PoolAllocate(*this->pool_, bytes, align);
+    }
+    void do_deallocate(void* ptr, size_t bytes, size_t) override {
+        internal::PoolDeallocate(*this->pool_, ptr, bytes);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    Pool* pool_;
+};
+#endif
+
+}  // namespace med
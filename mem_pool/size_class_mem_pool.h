@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "mem_pool/mem_pool.h"
+
+namespace med {
+
+// A MemPool companion whose objects can be given back one by one. Requests are rounded up to a size class and
+// carved from MemPool blocks; Free() pushes a chunk onto the free list of its class, where the next request of
+// that class picks it up again, both in O(1). Classes step by 16 bytes up to 1 KB and by a quarter of the power of
+// two above that up to kMaxClassSize, bigger requests go to operator new directly.
+//
+// Unlike MemPool the pool does not track destructors: Destroy() what Create() made before Reset() or destruction.
+class SizeClassMemPool {
+public:
+    static const size_t kSmallStep = 16;
+    static const size_t kSmallMax = 1024;
+    static const size_t kSmallClassNum = kSmallMax / kSmallStep;
+    static const int kMinLargeShift = 10;
+    static const int kMaxLargeShift = 15;
+    static const size_t kClassNum = kSmallClassNum + (kMaxLargeShift - kMinLargeShift + 1) * 4;
+    static const size_t kMaxClassSize = size_t(1) << (kMaxLargeShift + 1);
+
+    SizeClassMemPool() : SizeClassMemPool(4 * 1024, 1024 * 1024) {}
+    SizeClassMemPool(size_t block_size, size_t max_block_size, BlockSource* source = nullptr)
+        : arena_(block_size, max_block_size, 0, source) {
+        for (auto& head : this->free_lists_) {
+            head = nullptr;
+        }
+    }
+
+    SizeClassMemPool(const SizeClassMemPool&) = delete;
+    SizeClassMemPool& operator=(const SizeClassMemPool&) = delete;
+
+    // size bytes aligned to 16, give them back with Free(ptr, size)
+    void* Alloc(size_t size) {
+        if (size > kMaxClassSize) {
+            this->used_ += size;
+            return ::operator new(size);
+        }
+        size_t cls = ClassOf(size);
+        this->used_ += ClassSize(cls);
+        FreeChunk* chunk = this->free_lists_[cls];
+        if (chunk != nullptr) {
+            this->free_lists_[cls] = chunk->next;
+            return chunk;
+        }
+        return this->arena_.AllocAligned(ClassSize(cls), kSmallStep);
+    }
+
+    // size has to be the size ptr was allocated with
+    void Free(void* ptr, size_t size) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (size > kMaxClassSize) {
+            this->used_ -= size;
+            ::operator delete(ptr);
+            return;
+        }
+        size_t cls = ClassOf(size);
+        this->used_ -= ClassSize(cls);
+        FreeChunk* chunk = static_cast<FreeChunk*>(ptr);
+        chunk->next = this->free_lists_[cls];
+        this->free_lists_[cls] = chunk;
+    }
+
+    template <typename T, typename... Args>
+    T* Create(Args&&... args) {
+        static_assert(alignof(T) <= kSmallStep, "SizeClassMemPool aligns objects to 16 bytes");
+        void* data = this->Alloc(sizeof(T));
+        try {
+            return new (data) T(std::forward<Args>(args)...);
+        } catch (...) {
+            this->Free(data, sizeof(T));
+            throw;
+        }
+    }
+
+    template <typename T>
+    void Destroy(T* ptr) {
+        if (ptr != nullptr) {
+            ptr->~T();
+            this->Free(ptr, sizeof(T));
+        }
+    }
+
+    // bytes handed out and not freed yet, rounded up to their size classes
+    size_t Used() const { return this->used_; }
+
+    // bytes of the blocks backing the size classes
+    size_t AllocatedSize() const { return this->arena_.AllocatedSize(); }
+
+    // chunks waiting on the free list of the class size falls into
+    size_t FreeChunks(size_t size) const {
+        size_t n = 0;
+        for (FreeChunk* chunk = this->free_lists_[ClassOf(size)]; chunk != nullptr; chunk = chunk->next) {
+            ++n;
+        }
+        return n;
+    }
+
+    // forgets every allocation at once, memory above kMaxClassSize has to be freed before
+    void Reset() {
+        for (auto& head : this->free_lists_) {
+            head = nullptr;
+        }
+        this->used_ = 0;
+        this->arena_.Reset();
+    }
+
+    static size_t ClassOf(size_t size) {
+        if (size <= kSmallMax) {
+            return size == 0 ? 0 : (size - 1) / kSmallStep;
+        }
+        // 2^shift < size <= 2^(shift + 1), split into 4 classes
+        int shift = 63 - __builtin_clzll(size - 1);
+        size_t quarter = (size - 1 - (size_t(1) << shift)) >> (shift - 2);
+        return kSmallClassNum + (shift - kMinLargeShift) * 4 + quarter;
+    }
+
+    static size_t ClassSize(size_t cls) {
+        if (cls < kSmallClassNum) {
+            return (cls + 1) * kSmallStep;
+        }
+        cls -= kSmallClassNum;
+        int shift = kMinLargeShift + static_cast<int>(cls / 4);
+        return (size_t(1) << shift) + (cls % 4 + 1) * (size_t(1) << (shift - 2));
+    }
+
+private:
+    struct FreeChunk {
+        FreeChunk* next;
+    };
+
+    MemPool arena_;
+    FreeChunk* free_lists_[kClassNum];
+    size_t used_ = 0;
+};
+
+}  // namespace med
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+#include "object_pool/object_pool.h"
+
+namespace med {
+
+// Process wide free lists of fixed size slots, one per (size, alignment) pair.
+template <size_t Size, size_t Align>
+class PooledSlots {
+public:
+    static const size_t kCapacity = 4096;
+
+    struct Slot {
+        typename std::aligned_storage<Size, Align>::type data;
+    };
+
+    static Slot* Get() { return Pool().Get(); }
+    static void Put(Slot* slot) { Pool().Put(slot); }
+
+private:
+    static ObjectPool<Slot>& Pool() {
+        // never destroyed: a future may give its shared state back while statics are being torn down
+        static ObjectPool<Slot>* pool = new ObjectPool<Slot>(kCapacity, []() { return new Slot; });
+        return *pool;
+    }
+};
+
+// An allocator whose single object allocations are served from PooledSlots, so short lived objects of the same
+// size (e.g. the shared state of a std::promise) recycle memory instead of going through malloc every time.
+// Array allocations fall through to the global operator new.
+template <typename T>
+class PooledAllocator {
+public:
+    using value_type = T;
+
+    PooledAllocator() noexcept = default;
+    template <typename U>
+    PooledAllocator(const PooledAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n != 1) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return reinterpret_cast<T*>(PooledSlots<sizeof(T), alignof(T)>::Get());
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        if (n != 1) {
+            ::operator delete(ptr);
+            return;
+        }
+        using Slots = PooledSlots<sizeof(T), alignof(T)>;
+        Slots::Put(reinterpret_cast<typename Slots::Slot*>(ptr));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PooledAllocator<T>&, const PooledAllocator<U>&) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const PooledAllocator<T>&, const PooledAllocator<U>&) noexcept {
+    return false;
+}
+
+}  // namespace med
@@ -0,0 +1,293 @@
+#pragma once
+
+// C++20 coroutine integration of ThreadPool, only available when the compiler has coroutines enabled
+// (e.g. -std=c++20). The rest of the toolkit stays C++11.
+#if defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "thread_pool/thread_pool.h"
+
+namespace med {
+
+template <typename T = void>
+class Task;
+
+namespace internal {
+
+class TaskPromiseBase {
+public:
+    // resumes whoever awaited the task by symmetric transfer, on the thread that finished it
+    class FinalAwaiter {
+    public:
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> continuation = handle.promise().continuation_;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() { this->error_ = std::current_exception(); }
+
+    std::coroutine_handle<> continuation_ = nullptr;
+    std::exception_ptr error_ = nullptr;
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+public:
+    Task<T> get_return_object();
+
+    template <typename U>
+    void return_value(U&& value) {
+        this->value_.emplace(std::forward<U>(value));
+    }
+
+    T Result() {
+        if (this->error_ != nullptr) {
+            std::rethrow_exception(this->error_);
+        }
+        return std::move(*this->value_);
+    }
+
+private:
+    std::optional<T> value_;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+    Task<void> get_return_object();
+
+    void return_void() {}
+
+    void Result() {
+        if (this->error_ != nullptr) {
+            std::rethrow_exception(this->error_);
+        }
+    }
+};
+
+// a coroutine that starts right away and frees itself when done
+class DetachedTask {
+public:
+    class promise_type {
+    public:
+        DetachedTask get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+}  // namespace internal
+
+// A lazily started coroutine producing a T. It starts when awaited and, when it finishes, resumes the awaiting
+// coroutine on the thread it finished on, so a Task that hopped onto a pool with `co_await pool.Schedule()` hands
+// its awaiter back to that pool without parking any thread.
+template <typename T>
+class Task {
+public:
+    using promise_type = internal::TaskPromise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(handle_type handle) : handle_(handle) {}
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            this->Destroy();
+            this->handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { this->Destroy(); }
+
+    bool Done() const { return this->handle_ && this->handle_.done(); }
+
+    // starts the task and resumes the awaiter once it finished, without fetching the result
+    class ReadyAwaiter {
+    public:
+        explicit ReadyAwaiter(handle_type handle) : handle_(handle) {}
+        bool await_ready() const noexcept { return !this->handle_ || this->handle_.done(); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+            this->handle_.promise().continuation_ = awaiter;
+            return this->handle_;
+        }
+        void await_resume() const noexcept {}
+
+    protected:
+        handle_type handle_;
+    };
+
+    class Awaiter : public ReadyAwaiter {
+    public:
+        using ReadyAwaiter::ReadyAwaiter;
+        T await_resume() { return this->handle_.promise().Result(); }
+    };
+
+    Awaiter operator co_await() const& noexcept { return Awaiter(this->handle_); }
+    ReadyAwaiter WhenReady() const noexcept { return ReadyAwaiter(this->handle_); }
+
+    // the result of a finished task, rethrows its exception
+    T Result() { return this->handle_.promise().Result(); }
+
+private:
+    void Destroy() {
+        if (this->handle_) {
+            this->handle_.destroy();
+            this->handle_ = nullptr;
+        }
+    }
+
+private:
+    handle_type handle_ = nullptr;
+};
+
+namespace internal {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+template <typename T>
+DetachedTask FulfillPromise(Task<T> task, std::promise<T> promise) {
+    try {
+        if constexpr (std::is_void<T>::value) {
+            co_await task;
+            promise.set_value();
+        } else {
+            promise.set_value(co_await task);
+        }
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+    }
+}
+
+// the detached wrappers must not let anything escape, their unhandled_exception() terminates. a pool refusing to
+// schedule them (stopped, or a bounded pool that rejects) throws before their first suspension, still on the
+// thread that started them, so the error is stored to *refused for that thread and the task is not started.
+inline DetachedTask SpawnOn(ThreadPool& pool, Task<void> task, std::exception_ptr* refused) {
+    try {
+        co_await pool.Schedule();
+    } catch (...) {
+        *refused = std::current_exception();
+        co_return;
+    }
+    co_await task.WhenReady();
+}
+
+template <typename T>
+DetachedTask LaunchJoined(ThreadPool& pool, Task<T>& task, std::atomic<size_t>& remaining,
+                          std::coroutine_handle<> parent, std::exception_ptr* refused) {
+    bool scheduled = true;
+    try {
+        co_await pool.Schedule();
+    } catch (...) {
+        if (*refused == nullptr) {
+            *refused = std::current_exception();
+        }
+        scheduled = false;
+    }
+    if (scheduled) {
+        co_await task.WhenReady();
+    }
+    if (remaining.fetch_sub(1) == 1) {
+        parent.resume();
+    }
+}
+
+}  // namespace internal
+
+// runs task to completion from a thread that is not a coroutine, blocking it until the result is there
+template <typename T>
+T SyncWait(Task<T> task) {
+    std::promise<T> promise;
+    std::future<T> future = promise.get_future();
+    internal::FulfillPromise(std::move(task), std::move(promise));
+    return future.get();
+}
+
+// starts task on a worker of pool and lets it run on its own. an exception escaping it is dropped. throws like
+// Execute() when the pool refuses it, the task is not started then.
+inline void Spawn(ThreadPool& pool, Task<void> task) {
+    std::exception_ptr refused = nullptr;
+    internal::SpawnOn(pool, std::move(task), &refused);
+    if (refused != nullptr) {
+        std::rethrow_exception(refused);
+    }
+}
+
+// `co_await WhenAll(pool, tasks)` starts every task on a worker of pool and resumes the awaiting coroutine when
+// the last one finished. yields the results in order (nothing for Task<void>), rethrows the first failed task, or
+// the error of the pool when it refused to start one.
+template <typename T>
+class WhenAllAwaiter {
+public:
+    WhenAllAwaiter(ThreadPool& pool, std::vector<Task<T>> tasks) : pool_(pool), tasks_(std::move(tasks)) {}
+
+    bool await_ready() const noexcept { return this->tasks_.empty(); }
+
+    bool await_suspend(std::coroutine_handle<> parent) {
+        // one extra count held while launching, so the parent can not be resumed (and this awaiter destroyed)
+        // before the loop is done
+        this->remaining_.store(this->tasks_.size() + 1);
+        for (auto& task : this->tasks_) {
+            internal::LaunchJoined(this->pool_, task, this->remaining_, parent, &this->refused_);
+        }
+        return this->remaining_.fetch_sub(1) != 1;
+    }
+
+    auto await_resume() {
+        if (this->refused_ != nullptr) {
+            std::rethrow_exception(this->refused_);
+        }
+        if constexpr (std::is_void<T>::value) {
+            for (auto& task : this->tasks_) {
+                task.Result();
+            }
+        } else {
+            std::vector<T> results;
+            results.reserve(this->tasks_.size());
+            for (auto& task : this->tasks_) {
+                results.push_back(task.Result());
+            }
+            return results;
+        }
+    }
+
+private:
+    ThreadPool& pool_;
+    std::vector<Task<T>> tasks_;
+    std::atomic<size_t> remaining_{0};
+    // only written while launching, on the thread of await_suspend()
+    std::exception_ptr refused_ = nullptr;
+};
+
+template <typename T>
+WhenAllAwaiter<T> WhenAll(ThreadPool& pool, std::vector<Task<T>> tasks) {
+    return WhenAllAwaiter<T>(pool, std::move(tasks));
+}
+
+}  // namespace med
+
+#endif  // __cpp_impl_coroutine
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace med {
+
+// parses a kernel cpu list like "0-3,8,10-11", malformed pieces are skipped
+inline std::vector<int> ParseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string item = list.substr(pos, end - pos);
+        pos = end + 1;
+        char* rest = nullptr;
+        long first = std::strtol(item.c_str(), &rest, 10);
+        if (rest == item.c_str() || first < 0) {
+            continue;
+        }
+        long last = first;
+        if (*rest == '-') {
+            const char* start = rest + 1;
+            last = std::strtol(start, &rest, 10);
+            if (rest == start || last < first) {
+                continue;
+            }
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+// the cpus this process may run on, every hardware thread when the platform can not tell
+inline std::vector<int> AllowedCpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        int n = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < n; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// restricts the calling thread to cpus, returns false when that is not supported or the kernel refused
+inline bool PinCurrentThread(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    bool any = false;
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+            any = true;
+        }
+    }
+    return any && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+// the cpu the calling thread is running on right now, -1 if unknown
+inline int CurrentCpu() {
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+// The cpus of every NUMA node. Detect() reads /sys/devices/system/node and only keeps the cpus this process is
+// allowed to run on; when the topology can not be read every allowed cpu is put into a single node.
+class CpuTopology {
+public:
+    CpuTopology() = default;
+    explicit CpuTopology(std::vector<std::vector<int>> nodes) {
+        for (auto& cpus : nodes) {
+            if (!cpus.empty()) {
+                this->nodes_.push_back(std::move(cpus));
+            }
+        }
+        for (size_t node = 0; node < this->nodes_.size(); ++node) {
+            for (int cpu : this->nodes_[node]) {
+                if (cpu >= static_cast<int>(this->cpu_node_.size())) {
+                    this->cpu_node_.resize(cpu + 1, -1);
+                }
+                this->cpu_node_[cpu] = static_cast<int>(node);
+            }
+        }
+    }
+
+    static CpuTopology Detect() {
+        std::vector<int> allowed = AllowedCpus();
+        std::vector<std::vector<int>> nodes;
+#if defined(__linux__)
+        if (DIR* dir = opendir("/sys/devices/system/node")) {
+            std::vector<int> ids;
+            while (dirent* entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+                    name.find_first_not_of("0123456789", 4) == std::string::npos) {
+                    ids.push_back(std::atoi(name.c_str() + 4));
+                }
+            }
+            closedir(dir);
+            std::sort(ids.begin(), ids.end());
+            for (int id : ids) {
+                std::ifstream in("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+                std::string list;
+                std::getline(in, list);
+                nodes.push_back(Intersect(ParseCpuList(list), allowed));
+            }
+        }
+#endif
+        CpuTopology topology(std::move(nodes));
+        if (topology.Empty()) {
+            return CpuTopology({allowed});
+        }
+        return topology;
+    }
+
+    bool Empty() const { return this->nodes_.empty(); }
+    size_t NodeNum() const { return this->nodes_.size(); }
+    const std::vector<int>& NodeCpus(size_t node) const { return this->nodes_[node]; }
+
+    // node index of cpu, -1 when cpu is not part of the topology
+    int NodeOfCpu(int cpu) const {
+        if (cpu < 0 || cpu >= static_cast<int>(this->cpu_node_.size())) {
+            return -1;
+        }
+        return this->cpu_node_[cpu];
+    }
+
+    // the same topology limited to cpus, nodes left without cpus are dropped
+    CpuTopology Restrict(const std::vector<int>& cpus) const {
+        std::vector<std::vector<int>> nodes;
+        for (auto& node : this->nodes_) {
+            nodes.push_back(Intersect(node, cpus));
+        }
+        return CpuTopology(std::move(nodes));
+    }
+
+private:
+    static std::vector<int> Intersect(std::vector<int> a, std::vector<int> b) {
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        std::vector<int> out;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        return out;
+    }
+
+private:
+    std::vector<std::vector<int>> nodes_;
+    std::vector<int> cpu_node_;
+};
+
+}  // namespace med
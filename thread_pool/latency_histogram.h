@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace med {
+
+inline uint64_t MonotonicNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// A log-linear histogram of nanosecond durations in the style of HdrHistogram: every power of two is split into
+// 16 sub-buckets, so a recorded value is reported back within ~6% of its real value. Recording is one relaxed
+// atomic increment, which makes it cheap to call from many threads.
+class LatencyHistogram {
+public:
+    static const int kSubBucketBits = 4;
+    static const int kSubBucketNum = 1 << kSubBucketBits;
+    static const int kBucketNum = (64 - kSubBucketBits + 1) * kSubBucketNum;
+
+    LatencyHistogram() { this->Reset(); }
+    // copies take a snapshot, the counts are read one by one while other threads may keep recording
+    LatencyHistogram(const LatencyHistogram& other) {
+        this->Reset();
+        this->Merge(other);
+    }
+    LatencyHistogram& operator=(const LatencyHistogram& other) {
+        if (this != &other) {
+            this->Reset();
+            this->Merge(other);
+        }
+        return *this;
+    }
+
+    void Record(uint64_t ns) {
+        this->counts_[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+        this->sum_.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t max = this->max_.load(std::memory_order_relaxed);
+        while (ns > max && !this->max_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    void Reset() {
+        for (auto& c : this->counts_) {
+            c.store(0, std::memory_order_relaxed);
+        }
+        this->sum_.store(0, std::memory_order_relaxed);
+        this->max_.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t Count() const {
+        uint64_t count = 0;
+        for (auto& c : this->counts_) {
+            count += c.load(std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    uint64_t Sum() const { return this->sum_.load(std::memory_order_relaxed); }
+    uint64_t Max() const { return this->max_.load(std::memory_order_relaxed); }
+
+    double Mean() const {
+        uint64_t count = this->Count();
+        return count == 0 ? 0 : static_cast<double>(this->Sum()) / count;
+    }
+
+    // smallest recorded value v such that a fraction q (0 ~ 1) of the samples are <= v, rounded up to its bucket
+    uint64_t Percentile(double q) const {
+        uint64_t count = this->Count();
+        if (count == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(q * count + 0.5);
+        if (rank == 0) {
+            rank = 1;
+        }
+        uint64_t seen = 0;
+        for (int idx = 0; idx < kBucketNum; ++idx) {
+            seen += this->counts_[idx].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                uint64_t upper = BucketUpperBound(idx);
+                return upper < this->Max() ? upper : this->Max();
+            }
+        }
+        return this->Max();
+    }
+
+    // adds the samples of other into this histogram
+    void Merge(const LatencyHistogram& other) {
+        for (int idx = 0; idx < kBucketNum; ++idx) {
+            uint64_t c = other.counts_[idx].load(std::memory_order_relaxed);
+            if (c > 0) {
+                this->counts_[idx].fetch_add(c, std::memory_order_relaxed);
+            }
+        }
+        this->sum_.fetch_add(other.Sum(), std::memory_order_relaxed);
+        uint64_t ns = other.Max();
+        uint64_t max = this->max_.load(std::memory_order_relaxed);
+        while (ns > max && !this->max_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    static int BucketIndex(uint64_t ns) {
+        if (ns < kSubBucketNum) {
+            return static_cast<int>(ns);
+        }
+        int exponent = 63 - __builtin_clzll(ns);
+        int shift = exponent - kSubBucketBits;
+        return (shift + 1) * kSubBucketNum + static_cast<int>((ns >> shift) & (kSubBucketNum - 1));
+    }
+
+    static uint64_t BucketUpperBound(int idx) {
+        if (idx < kSubBucketNum) {
+            return idx;
+        }
+        int shift = idx / kSubBucketNum - 1;
+        uint64_t base = static_cast<uint64_t>(kSubBucketNum | (idx % kSubBucketNum)) << shift;
+        return base + ((uint64_t(1) << shift) - 1);
+    }
+
+private:
+    std::atomic<uint64_t> counts_[kBucketNum];
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+}  // namespace med
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "thread_pool/thread_pool.h"
+
+namespace med {
+
+// A set of tasks running on a ThreadPool that can be waited for together. Wait() runs queued pool tasks on the
+// calling thread until the group is done, so it never parks a thread the pool may need, and waiting from inside a
+// pool task can not deadlock even a single worker pool. The first exception thrown by a task is rethrown by Wait().
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool_(pool) {}
+    ~TaskGroup() {
+        while (this->pending_.load() > 0) {
+            this->HelpOnce();
+        }
+    }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    template <class F>
+    void Run(F&& f) {
+        this->pending_.fetch_add(1);
+        try {
+            this->pool_.Execute(GroupTask<typename std::decay<F>::type>(this, std::forward<F>(f)));
+        } catch (...) {
+            this->pending_.fetch_sub(1);
+            throw;
+        }
+    }
+
+    void Wait() {
+        while (this->pending_.load() > 0) {
+            this->HelpOnce();
+        }
+        if (this->error_ != nullptr) {
+            std::exception_ptr error = this->error_;
+            this->error_ = nullptr;
+            this->has_error_ = false;
+            std::rethrow_exception(error);
+        }
+    }
+
+    ThreadPool& Pool() { return this->pool_; }
+
+private:
+    template <class F>
+    class GroupTask {
+    public:
+        template <class Fn>
+        GroupTask(TaskGroup* group, Fn&& fn) : group_(group), fn_(std::forward<Fn>(fn)) {}
+        void operator()() {
+            // once a task failed the rest of the group is skipped
+            if (!this->group_->has_error_.load(std::memory_order_relaxed)) {
+                try {
+                    this->fn_();
+                } catch (...) {
+                    this->group_->SetError(std::current_exception());
+                }
+            }
+            this->group_->pending_.fetch_sub(1);
+        }
+
+    private:
+        TaskGroup* group_;
+        F fn_;
+    };
+
+    void SetError(std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if (this->error_ == nullptr) {
+            this->error_ = error;
+            this->has_error_ = true;
+        }
+    }
+
+    void HelpOnce() {
+        if (!this->pool_.RunPendingTask()) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    ThreadPool& pool_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<bool> has_error_{false};
+    std::mutex mutex_;
+    std::exception_ptr error_ = nullptr;
+};
+
+// grain 0 picks a chunk size that gives every thread (workers plus the caller) about 8 chunks, enough to even out
+// imbalanced chunks without paying for a task per element
+inline size_t AutoGrain(const ThreadPool& pool, size_t n, size_t grain) {
+    if (grain > 0) {
+        return grain;
+    }
+    return std::max<size_t>(1, n / (8 * (pool.Size() + 1)));
+}
+
+namespace internal {
+
+template <class Index, class F>
+void SplitRange(TaskGroup& group, Index begin, Index end, size_t grain, const F& fn) {
+    // hand the right half to the pool and keep halving the left one, so thieves take big pieces first
+    while (static_cast<size_t>(end - begin) > grain) {
+        Index mid = begin + (end - begin) / 2;
+        group.Run([&group, mid, end, grain, &fn]() { SplitRange(group, mid, end, grain, fn); });
+        end = mid;
+    }
+    fn(begin, end);
+}
+
+template <class Iter, class Compare>
+void QuickSort(TaskGroup& group, Iter first, Iter last, Compare comp, size_t cutoff) {
+    using value_type = typename std::iterator_traits<Iter>::value_type;
+    while (static_cast<size_t>(last - first) > cutoff) {
+        Iter middle = first + (last - first) / 2;
+        Iter back = last - 1;
+        // median of three
+        if (comp(*middle, *first)) {
+            std::iter_swap(middle, first);
+        }
+        if (comp(*back, *middle)) {
+            std::iter_swap(back, middle);
+            if (comp(*middle, *first)) {
+                std::iter_swap(middle, first);
+            }
+        }
+        value_type pivot = *middle;
+        Iter lower = std::partition(first, last, [&pivot, &comp](const value_type& v) { return comp(v, pivot); });
+        Iter upper = std::partition(lower, last, [&pivot, &comp](const value_type& v) { return !comp(pivot, v); });
+        // [first, lower) < pivot, [lower, upper) == pivot, [upper, last) > pivot
+        if (lower - first < last - upper) {
+            group.Run([&group, upper, last, comp, cutoff]() { QuickSort(group, upper, last, comp, cutoff); });
+            last = lower;
+        } else {
+            group.Run([&group, first, lower, comp, cutoff]() { QuickSort(group, first, lower, comp, cutoff); });
+            first = upper;
+        }
+    }
+    std::sort(first, last, comp);
+}
+
+}  // namespace internal
+
+// calls fn(chunk_begin, chunk_end) for chunks of at most grain indexes covering [begin, end). the range is split
+// recursively, the calling thread works on chunks too and returns when all of them are done.
+template <class Index, class F>
+void ParallelForRange(ThreadPool& pool, Index begin, Index end, size_t grain, const F& fn) {
+    if (!(begin < end)) {
+        return;
+    }
+    grain = AutoGrain(pool, static_cast<size_t>(end - begin), grain);
+    TaskGroup group(pool);
+    internal::SplitRange(group, begin, end, grain, fn);
+    group.Wait();
+}
+
+// calls fn(i) for every i in [begin, end)
+template <class Index, class F>
+void ParallelFor(ThreadPool& pool, Index begin, Index end, size_t grain, const F& fn) {
+    ParallelForRange(pool, begin, end, grain, [&fn](Index first, Index last) {
+        for (Index i = first; i < last; ++i) {
+            fn(i);
+        }
+    });
+}
+
+// reduces [begin, end) chunk by chunk: every chunk computes reduce(chunk_begin, chunk_end, identity), the chunk
+// results are then folded from left to right with combine, so combine only has to be associative.
+template <class Index, class T, class Reduce, class Combine>
+T ParallelReduce(ThreadPool& pool, Index begin, Index end, size_t grain, const T& identity, const Reduce& reduce,
+                 const Combine& combine) {
+    if (!(begin < end)) {
+        return identity;
+    }
+    size_t n = static_cast<size_t>(end - begin);
+    grain = AutoGrain(pool, n, grain);
+    size_t chunk_num = (n + grain - 1) / grain;
+    std::vector<T> partial(chunk_num, identity);
+    ParallelFor(pool, size_t(0), chunk_num, 1, [&](size_t chunk) {
+        Index first = begin + chunk * grain;
+        Index last = chunk + 1 == chunk_num ? end : first + grain;
+        partial[chunk] = reduce(first, last, identity);
+    });
+    T result = identity;
+    for (auto& v : partial) {
+        result = combine(result, v);
+    }
+    return result;
+}
+
+// d_first[i] = op(first[i]) for random access iterators
+template <class InputIt, class OutputIt, class UnaryOp>
+OutputIt ParallelTransform(ThreadPool& pool, InputIt first, InputIt last, OutputIt d_first, size_t grain,
+                           const UnaryOp& op) {
+    auto n = last - first;
+    ParallelForRange(pool, decltype(n)(0), n, grain, [&](decltype(n) b, decltype(n) e) {
+        std::transform(first + b, first + e, d_first + b, op);
+    });
+    return d_first + n;
+}
+
+// unstable parallel quicksort, ranges below the cutoff are finished with std::sort
+template <class Iter, class Compare>
+void ParallelSort(ThreadPool& pool, Iter first, Iter last, Compare comp) {
+    size_t n = static_cast<size_t>(last - first);
+    size_t cutoff = std::max<size_t>(2048, n / (8 * (pool.Size() + 1)));
+    TaskGroup group(pool);
+    internal::QuickSort(group, first, last, comp, cutoff);
+    group.Wait();
+}
+
+template <class Iter>
+void ParallelSort(ThreadPool& pool, Iter first, Iter last) {
+    ParallelSort(pool, first, last, std::less<typename std::iterator_traits<Iter>::value_type>());
+}
+
+}  // namespace med
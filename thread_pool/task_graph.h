@@ -0,0 +1,538 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "thread_pool/thread_pool.h"
+#include "thread_pool/unique_task.h"
+
+namespace med {
+
+template <typename T>
+class Future;
+
+namespace internal {
+
+struct Unit {};
+
+template <typename T>
+struct FutureValue {
+    using type = T;
+};
+
+template <>
+struct FutureValue<void> {
+    using type = Unit;
+};
+
+// State shared by a Promise and its Futures. Callbacks run on the thread that completes the state, they are
+// expected to be cheap (typically they only submit the real continuation to a pool).
+template <typename T>
+class FutureState {
+public:
+    using value_type = typename FutureValue<T>::type;
+
+    void SetValue(value_type&& value) {
+        std::unique_lock<std::mutex> lock(this->mutex_);
+        if (this->ready_) throw std::logic_error("future already satisfied");
+        this->value_ = std::move(value);
+        this->Complete(lock);
+    }
+
+    void SetError(std::exception_ptr error) {
+        std::unique_lock<std::mutex> lock(this->mutex_);
+        if (this->ready_) throw std::logic_error("future already satisfied");
+        this->error_ = error;
+        this->Complete(lock);
+    }
+
+    // callback runs right away when the state is already complete
+    void OnReady(UniqueTask&& callback) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            if (!this->ready_) {
+                this->callbacks_.push_back(std::move(callback));
+                return;
+            }
+        }
+        callback();
+    }
+
+    void Wait() {
+        std::unique_lock<std::mutex> lock(this->mutex_);
+        this->cv_.wait(lock, [this] { return this->ready_; });
+    }
+
+    bool Ready() {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        return this->ready_;
+    }
+
+    // only valid once ready
+    const value_type& Value() const { return this->value_; }
+    std::exception_ptr Error() const { return this->error_; }
+
+private:
+    void Complete(std::unique_lock<std::mutex>& lock) {
+        this->ready_ = true;
+        std::vector<UniqueTask> callbacks;
+        callbacks.swap(this->callbacks_);
+        lock.unlock();
+        this->cv_.notify_all();
+        for (auto& callback : callbacks) {
+            callback();
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool ready_ = false;
+    value_type value_;
+    std::exception_ptr error_ = nullptr;
+    std::vector<UniqueTask> callbacks_;
+};
+
+// calls f with the value of a future, or without arguments for Future<void>
+template <typename T>
+struct ContinuationInvoker {
+    template <typename F>
+    static auto Invoke(F& f, const T& value) -> decltype(f(value)) {
+        return f(value);
+    }
+};
+
+template <>
+struct ContinuationInvoker<void> {
+    template <typename F>
+    static auto Invoke(F& f, const Unit&) -> decltype(f()) {
+        return f();
+    }
+};
+
+template <typename T, typename F>
+using ContinuationResult = decltype(ContinuationInvoker<T>::Invoke(std::declval<F&>(),
+                                                                   std::declval<const typename FutureValue<T>::type&>()));
+
+// runs f and stores its outcome into state. only f is guarded: what the callbacks run by SetValue() throw must not
+// turn into a second completion of state
+template <typename R>
+struct Fulfiller {
+    template <typename F>
+    static void Run(FutureState<R>& state, F&& f) {
+        typename FutureValue<R>::type value;
+        try {
+            value = f();
+        } catch (...) {
+            state.SetError(std::current_exception());
+            return;
+        }
+        state.SetValue(std::move(value));
+    }
+};
+
+template <>
+struct Fulfiller<void> {
+    template <typename F>
+    static void Run(FutureState<void>& state, F&& f) {
+        try {
+            f();
+        } catch (...) {
+            state.SetError(std::current_exception());
+            return;
+        }
+        state.SetValue(Unit());
+    }
+};
+
+template <typename T>
+struct ValueGetter {
+    static T Get(const FutureState<T>& state) { return state.Value(); }
+};
+
+template <>
+struct ValueGetter<void> {
+    static void Get(const FutureState<void>&) {}
+};
+
+}  // namespace internal
+
+// The producing side of a Future, for results that do not come from a pool task.
+template <typename T>
+class Promise {
+public:
+    Promise() : state_(std::make_shared<internal::FutureState<T>>()) {}
+
+    Future<T> GetFuture() const { return Future<T>(this->state_); }
+
+    template <typename U = T, typename = typename std::enable_if<!std::is_void<U>::value>::type>
+    void SetValue(U value) {
+        this->state_->SetValue(std::move(value));
+    }
+
+    template <typename U = T, typename = typename std::enable_if<std::is_void<U>::value>::type>
+    void SetValue() {
+        this->state_->SetValue(internal::Unit());
+    }
+
+    void SetException(std::exception_ptr error) { this->state_->SetError(error); }
+
+private:
+    std::shared_ptr<internal::FutureState<T>> state_;
+};
+
+// A copyable handle to a value produced asynchronously. Unlike std::future it supports continuations: Then()
+// schedules a function on a pool as soon as the value is there, so chaining stages never parks a thread.
+// T has to be default constructible (or void).
+template <typename T>
+class Future {
+public:
+    Future() = default;
+    explicit Future(std::shared_ptr<internal::FutureState<T>> state) : state_(std::move(state)) {}
+
+    bool Valid() const { return this->state_ != nullptr; }
+    bool Ready() const { return this->state_->Ready(); }
+    void Wait() const { this->state_->Wait(); }
+
+    // blocks until ready, rethrows the exception of a failed computation. prefer Then() inside pool tasks.
+    T Get() const {
+        this->state_->Wait();
+        if (this->state_->Error() != nullptr) {
+            std::rethrow_exception(this->state_->Error());
+        }
+        return internal::ValueGetter<T>::Get(*this->state_);
+    }
+
+    // runs f(value) (f() for Future<void>) on pool once this future is ready and returns a future of its result.
+    // an exception of this future skips f and is passed on to the returned one.
+    template <typename F>
+    Future<internal::ContinuationResult<T, typename std::decay<F>::type>> Then(ThreadPool& pool, F&& f) const {
+        using result_type = internal::ContinuationResult<T, typename std::decay<F>::type>;
+        auto next = std::make_shared<internal::FutureState<result_type>>();
+        this->state_->OnReady(Continuation<typename std::decay<F>::type, result_type>(&pool, this->state_, next,
+                                                                                      std::forward<F>(f)));
+        return Future<result_type>(next);
+    }
+
+    const std::shared_ptr<internal::FutureState<T>>& State() const { return this->state_; }
+
+private:
+    template <typename F, typename R>
+    class Continuation {
+    public:
+        // prev is held weakly: it is alive whenever it runs its callbacks, and an abandoned promise does not keep
+        // itself alive through its own callback list
+        template <typename Fn>
+        Continuation(ThreadPool* pool, const std::shared_ptr<internal::FutureState<T>>& prev,
+                     std::shared_ptr<internal::FutureState<R>> next, Fn&& f)
+            : pool_(pool), prev_(prev), next_(std::move(next)), f_(std::forward<Fn>(f)) {}
+
+        // called when prev is ready: hand the real work to the pool
+        void operator()() {
+            std::shared_ptr<internal::FutureState<T>> prev = this->prev_.lock();
+            std::shared_ptr<internal::FutureState<R>> next = std::move(this->next_);
+            if (prev->Error() != nullptr) {
+                next->SetError(prev->Error());
+                return;
+            }
+            auto f = std::make_shared<F>(std::move(this->f_));
+            // runs among the callbacks of prev, a pool refusing the work fails next instead of escaping into them
+            try {
+                this->pool_->Execute([prev, next, f]() {
+                    internal::Fulfiller<R>::Run(
+                        *next, [&]() { return internal::ContinuationInvoker<T>::Invoke(*f, prev->Value()); });
+                });
+            } catch (...) {
+                next->SetError(std::current_exception());
+            }
+        }
+
+    private:
+        ThreadPool* pool_;
+        std::weak_ptr<internal::FutureState<T>> prev_;
+        std::shared_ptr<internal::FutureState<R>> next_;
+        F f_;
+    };
+
+private:
+    std::shared_ptr<internal::FutureState<T>> state_;
+};
+
+// runs f on pool and returns a Future of its result
+template <typename F>
+auto Async(ThreadPool& pool, F&& f) -> Future<decltype(f())> {
+    using result_type = decltype(f());
+    auto state = std::make_shared<internal::FutureState<result_type>>();
+    auto fn = std::make_shared<typename std::decay<F>::type>(std::forward<F>(f));
+    pool.Execute([state, fn]() { internal::Fulfiller<result_type>::Run(*state, *fn); });
+    return Future<result_type>(state);
+}
+
+// ready when every future is ready. it fails with the first failure among them (in completion order), the values
+// themselves are read from the inputs.
+template <typename T>
+Future<void> WhenAll(const std::vector<Future<T>>& futures) {
+    struct Join {
+        std::atomic<size_t> remaining;
+        std::mutex mutex;
+        std::exception_ptr error = nullptr;
+        std::shared_ptr<internal::FutureState<void>> state = std::make_shared<internal::FutureState<void>>();
+    };
+    auto join = std::make_shared<Join>();
+    join->remaining = futures.size();
+    if (futures.empty()) {
+        join->state->SetValue(internal::Unit());
+    }
+    for (auto& future : futures) {
+        std::weak_ptr<internal::FutureState<T>> weak_input = future.State();
+        future.State()->OnReady([join, weak_input]() {
+            std::shared_ptr<internal::FutureState<T>> input = weak_input.lock();
+            if (input->Error() != nullptr) {
+                std::lock_guard<std::mutex> lock(join->mutex);
+                if (join->error == nullptr) {
+                    join->error = input->Error();
+                }
+            }
+            if (join->remaining.fetch_sub(1) == 1) {
+                if (join->error != nullptr) {
+                    join->state->SetError(join->error);
+                } else {
+                    join->state->SetValue(internal::Unit());
+                }
+            }
+        });
+    }
+    return Future<void>(join->state);
+}
+
+// ready as soon as one of the futures is ready (with a value or an exception), holds the index of that future
+template <typename T>
+Future<size_t> WhenAny(const std::vector<Future<T>>& futures) {
+    if (futures.empty()) throw std::invalid_argument("WhenAny of no futures");
+    auto state = std::make_shared<internal::FutureState<size_t>>();
+    auto done = std::make_shared<std::atomic<bool>>(false);
+    for (size_t idx = 0; idx < futures.size(); ++idx) {
+        futures[idx].State()->OnReady([state, done, idx]() {
+            if (!done->exchange(true)) {
+                state->SetValue(size_t(idx));
+            }
+        });
+    }
+    return Future<size_t>(state);
+}
+
+// A reusable DAG of tasks. Nodes and edges are added once, every Run() then schedules each node on the pool as
+// soon as all of its predecessors finished. A run only resets per node counters, nothing is rebuilt or allocated
+// per node. A failing node does not stop the run, its successors (and all later nodes) are skipped and the
+// exception is reported through the returned future.
+class TaskGraph {
+public:
+    using NodeId = size_t;
+
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    NodeId AddNode(std::function<void()> fn) {
+        this->CheckIdle();
+        this->nodes_.emplace_back(new Node(std::move(fn)));
+        this->validated_ = false;
+        return this->nodes_.size() - 1;
+    }
+
+    // to runs after from finished
+    void AddEdge(NodeId from, NodeId to) {
+        this->CheckIdle();
+        if (from >= this->nodes_.size() || to >= this->nodes_.size()) throw std::out_of_range("no such node");
+        this->nodes_[from]->successors_.push_back(to);
+        ++this->nodes_[to]->in_degree_;
+        this->validated_ = false;
+    }
+
+    size_t Size() const { return this->nodes_.size(); }
+
+    // starts a run, the graph must stay alive until the returned future is ready. only one run at a time. when the
+    // pool refuses the first node (stopped, or QueueFullError of a bounded pool) Run() throws and the graph stays
+    // idle; when it refuses a later one the run fails with that error and the nodes not started yet are skipped.
+    Future<void> Run(ThreadPool& pool) {
+        if (this->running_.exchange(true)) throw std::logic_error("TaskGraph is already running");
+        if (!this->validated_) {
+            try {
+                this->Validate();
+            } catch (...) {
+                this->running_ = false;
+                throw;
+            }
+        }
+        this->pool_ = &pool;
+        this->failed_ = false;
+        this->error_ = nullptr;
+        this->done_ = std::make_shared<internal::FutureState<void>>();
+        Future<void> result(this->done_);
+        if (this->nodes_.empty()) {
+            this->Finish();
+            return result;
+        }
+        this->remaining_ = this->nodes_.size();
+        for (auto& node : this->nodes_) {
+            node->pending_.store(node->in_degree_, std::memory_order_relaxed);
+        }
+        bool scheduled = false;
+        for (NodeId id = 0; id < this->nodes_.size(); ++id) {
+            if (this->nodes_[id]->in_degree_ != 0) {
+                continue;
+            }
+            if (this->failed_) {
+                this->Execute(id);
+                continue;
+            }
+            try {
+                this->Schedule(id);
+                scheduled = true;
+            } catch (...) {
+                if (!scheduled) {
+                    this->done_.reset();
+                    this->running_ = false;
+                    throw;
+                }
+                // the roots already scheduled keep running, the rest of the graph drains here without running
+                this->Fail(std::current_exception());
+                this->Execute(id);
+            }
+        }
+        return result;
+    }
+
+private:
+    class Node {
+    public:
+        explicit Node(std::function<void()> fn) : fn_(std::move(fn)) {}
+
+        std::function<void()> fn_;
+        std::vector<NodeId> successors_;
+        size_t in_degree_ = 0;
+        std::atomic<size_t> pending_{0};
+    };
+
+    void CheckIdle() const {
+        if (this->running_) throw std::logic_error("TaskGraph can not be changed while running");
+    }
+
+    // Kahn's algorithm, throws on a cycle
+    void Validate() {
+        std::vector<size_t> in_degree(this->nodes_.size());
+        std::vector<NodeId> ready;
+        for (NodeId id = 0; id < this->nodes_.size(); ++id) {
+            in_degree[id] = this->nodes_[id]->in_degree_;
+            if (in_degree[id] == 0) {
+                ready.push_back(id);
+            }
+        }
+        size_t visited = 0;
+        while (!ready.empty()) {
+            NodeId id = ready.back();
+            ready.pop_back();
+            ++visited;
+            for (NodeId next : this->nodes_[id]->successors_) {
+                if (--in_degree[next] == 0) {
+                    ready.push_back(next);
+                }
+            }
+        }
+        if (visited != this->nodes_.size()) throw std::invalid_argument("TaskGraph has a cycle");
+        this->validated_ = true;
+    }
+
+    void Schedule(NodeId id) {
+        this->pool_->Execute([this, id]() { this->Execute(id); });
+    }
+
+    void Execute(NodeId id) {
+        // once the run failed the nodes left are only counted down, so they are walked here instead of queued. this
+        // runs on the workers, so nothing may escape from it.
+        std::vector<NodeId> skipped;
+        // a node that makes exactly one successor ready runs it right here instead of going through the queue
+        while (id != kNoNode) {
+            Node& node = *this->nodes_[id];
+            if (!this->failed_.load(std::memory_order_relaxed)) {
+                try {
+                    node.fn_();
+                } catch (...) {
+                    this->Fail(std::current_exception());
+                }
+            }
+            NodeId next = kNoNode;
+            for (NodeId successor : node.successors_) {
+                if (this->nodes_[successor]->pending_.fetch_sub(1) == 1) {
+                    if (next != kNoNode) {
+                        if (!this->failed_.load(std::memory_order_relaxed)) {
+                            try {
+                                this->Schedule(next);
+                                next = kNoNode;
+                            } catch (...) {
+                                // a refusing pool fails the run like a throwing node, its node is walked here
+                                this->Fail(std::current_exception());
+                            }
+                        }
+                        if (next != kNoNode) {
+                            skipped.push_back(next);
+                        }
+                    }
+                    next = successor;
+                }
+            }
+            if (this->remaining_.fetch_sub(1) == 1) {
+                this->Finish();
+                return;
+            }
+            id = next;
+            if (id == kNoNode && !skipped.empty()) {
+                id = skipped.back();
+                skipped.pop_back();
+            }
+        }
+    }
+
+    // the first error wins
+    void Fail(std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if (this->error_ == nullptr) {
+            this->error_ = error;
+            this->failed_ = true;
+        }
+    }
+
+    void Finish() {
+        std::shared_ptr<internal::FutureState<void>> done = std::move(this->done_);
+        std::exception_ptr error = this->error_;
+        this->running_ = false;
+        if (error != nullptr) {
+            done->SetError(error);
+        } else {
+            done->SetValue(internal::Unit());
+        }
+    }
+
+private:
+    static const NodeId kNoNode = static_cast<NodeId>(-1);
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+    bool validated_ = false;
+    std::atomic<bool> running_{false};
+    ThreadPool* pool_ = nullptr;
+    std::atomic<size_t> remaining_{0};
+    std::atomic<bool> failed_{false};
+    std::mutex mutex_;
+    std::exception_ptr error_ = nullptr;
+    std::shared_ptr<internal::FutureState<void>> done_;
+};
+
+}  // namespace med
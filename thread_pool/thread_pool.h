@@ -4,59 +4,1282 @@
 #include <thread>
 #include <future>
 #include <functional>
+#include <iterator>
+#include <limits>
 #include <stdexcept>
-#include <concurrentqueue/blockingconcurrentqueue.h>
+#include <string>
+#include <concurrentqueue/concurrentqueue.h>
+#include <algorithm>
 #include <atomic>
-#include <functional>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+
+#include "object_pool/pooled_allocator.h"
+#include "thread_pool/cpu_topology.h"
+#include "thread_pool/latency_histogram.h"
+#include "thread_pool/thread_pool_stats.h"
+#include "thread_pool/timing_wheel.h"
+#include "thread_pool/unique_task.h"
 
 namespace med {
 
+// A deque owned by one worker. The owner pushes and pops at the back (LIFO), other workers steal from the
+// front (FIFO), so the oldest and usually largest pieces of work migrate first. Items live in a ring buffer
+// that only grows, so a warmed up queue never allocates.
+template <typename T>
+class WorkStealingQueue {
+public:
+    WorkStealingQueue() : items_(16) {}
+
+    void PushBack(T&& item) {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if (this->size_ == this->items_.size()) {
+            this->Grow();
+        }
+        this->items_[(this->head_ + this->size_) & (this->items_.size() - 1)] = std::move(item);
+        ++this->size_;
+    }
+
+    bool PopBack(T& item) {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if (this->size_ == 0) {
+            return false;
+        }
+        --this->size_;
+        item = std::move(this->items_[(this->head_ + this->size_) & (this->items_.size() - 1)]);
+        return true;
+    }
+
+    bool StealFront(T& item) {
+        std::unique_lock<std::mutex> lock(this->mutex_, std::try_to_lock);
+        if (!lock.owns_lock() || this->size_ == 0) {
+            return false;
+        }
+        item = std::move(this->items_[this->head_]);
+        this->head_ = (this->head_ + 1) & (this->items_.size() - 1);
+        --this->size_;
+        return true;
+    }
+
+    size_t SizeApprox() const {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        return this->size_;
+    }
+
+private:
+    void Grow() {
+        std::vector<T> items(this->items_.size() * 2);
+        for (size_t i = 0; i < this->size_; ++i) {
+            items[i] = std::move(this->items_[(this->head_ + i) & (this->items_.size() - 1)]);
+        }
+        this->items_.swap(items);
+        this->head_ = 0;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<T> items_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+};
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Parks idle workers on a condition variable. A worker announces itself with PrepareWait() before its last look
+// at the queues, so a producer that publishes a task afterwards always sees the waiter and signals it. Producers
+// only touch the mutex when somebody is actually parked.
+class Parker {
+public:
+    void PrepareWait() {
+        this->waiters_.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void CancelWait() { this->waiters_.fetch_sub(1); }
+
+    // blocks until a notification issued after PrepareWait(), or until Close()
+    void Wait() {
+        std::unique_lock<std::mutex> lock(this->mutex_);
+        this->cv_.wait(lock, [this] { return this->signals_ > 0 || this->closed_; });
+        if (this->signals_ > 0) {
+            --this->signals_;
+        }
+        this->waiters_.fetch_sub(1);
+    }
+
+    // Wait() that gives up after timeout, returns false if it did
+    template <class Rep, class Period>
+    bool WaitFor(const std::chrono::duration<Rep, Period>& timeout) {
+        std::unique_lock<std::mutex> lock(this->mutex_);
+        bool woken = this->cv_.wait_for(lock, timeout, [this] { return this->signals_ > 0 || this->closed_; });
+        if (this->signals_ > 0) {
+            --this->signals_;
+            woken = true;
+        }
+        this->waiters_.fetch_sub(1);
+        return woken;
+    }
+
+    size_t NotifyOne() { return this->Notify(1); }
+
+    // wakes up to n parked workers, returns how many new wake-ups were handed out
+    size_t Notify(size_t n) {
+        if (n == 0) {
+            return 0;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        size_t waiters = this->waiters_.load(std::memory_order_relaxed);
+        if (waiters == 0) {
+            return 0;
+        }
+        size_t woken = 0;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            size_t signals = std::min(this->signals_ + n, waiters);
+            woken = signals > this->signals_ ? signals - this->signals_ : 0;
+            this->signals_ = signals;
+        }
+        if (n == 1) {
+            this->cv_.notify_one();
+        } else {
+            this->cv_.notify_all();
+        }
+        return woken;
+    }
+
+    // wakes every waiter now and makes later Wait() calls return immediately
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            this->closed_ = true;
+        }
+        this->cv_.notify_all();
+    }
+
+    size_t WaitersApprox() const { return this->waiters_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<size_t> waiters_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t signals_ = 0;
+    bool closed_ = false;
+};
+
+// Every priority has its own lane. Workers drain higher lanes first, see ThreadPoolOptions::starvation_interval
+// for how lower lanes still make progress.
+enum class TaskPriority : uint8_t {
+    kHigh = 0,
+    kNormal = 1,
+    kLow = 2,
+};
+
+static const size_t kTaskPriorityNum = 3;
+
+// what a pool with ThreadPoolOptions::queue_capacity does with a task that finds the queue full
+enum class OverflowPolicy : uint8_t {
+    // wait up to block_timeout_us for room, then reject. a worker of the pool runs the task itself instead of
+    // waiting, since it could be the one that has to make room.
+    kBlock = 0,
+    kReject = 1,
+    // the submitting thread runs the task right away
+    kCallerRuns = 2,
+    // drops the oldest queued task of the lowest priority lane that has one, its future gets a broken_promise
+    kDropOldest = 3,
+};
+
+// thrown by Enqueue / Execute and the bulk versions when a bounded pool rejects a task
+class QueueFullError : public std::runtime_error {
+public:
+    QueueFullError() : std::runtime_error("ThreadPool queue is full") {}
+};
+
+// overflow decisions of a bounded ThreadPool
+class AdmissionCounters {
+public:
+    size_t rejected = 0;
+    size_t blocked = 0;
+    size_t block_timeouts = 0;
+    size_t caller_runs = 0;
+    size_t dropped = 0;
+};
+
+// identifies a task scheduled with ThreadPool::ScheduleAfter / ScheduleAt / ScheduleEvery
+using TimerId = uint64_t;
+
+#if __cplusplus > 201402L
+template <class F, class... Args>
+using TaskResult = typename std::invoke_result<F, Args...>::type;
+#else
+template <class F, class... Args>
+using TaskResult = typename std::result_of<F(Args...)>::type;
+#endif
+
+class ThreadPoolOptions {
+public:
+    size_t concurrency_num = 1;
+    // every worker owns a deque: tasks enqueued from a worker go to its own deque, idle workers steal from others
+    bool work_stealing = false;
+    // an idle worker polls the queues spin_count times (with a cpu pause), then yields yield_count times, then parks.
+    // raise spin_count to trade idle cpu for wake-up latency, 0 parks right away.
+    size_t spin_count = 128;
+    size_t yield_count = 16;
+    // every starvation_interval-th dequeue of a worker tries a lower lane first (the lower lanes take turns), so a
+    // flood of high priority work can not starve the rest. 0 disables it.
+    size_t starvation_interval = 16;
+    // timestamp every task on submission and record its queue wait per lane, see QueueWaitHistogram()
+    bool track_queue_wait = false;
+    // per worker queue wait and run time histograms, task counts and busy/idle time, see ThreadPool::Stats()
+    bool collect_stats = false;
+    // record the lifetime of every task (at most trace_max_events per worker) for ThreadPool::WriteTrace(). a
+    // non-empty trace_path writes the trace there when the pool is destroyed.
+    bool trace = false;
+    size_t trace_max_events = 1 << 20;
+    std::string trace_path;
+    // resolution of ScheduleAfter / ScheduleAt / ScheduleEvery, tasks are never started before their time
+    uint64_t timer_tick_us = 1000;
+    // at most queue_capacity tasks wait in the queues (0 for no limit), overflow_policy decides about the rest.
+    // due timers are always queued, they were admitted when they were scheduled.
+    size_t queue_capacity = 0;
+    OverflowPolicy overflow_policy = OverflowPolicy::kBlock;
+    // 0 blocks until there is room
+    uint64_t block_timeout_us = 0;
+    // pin the workers to these cpus. without numa_aware worker i runs on cpu_set[i % size], with it the set only
+    // limits the cpus (and so the nodes) the workers are spread over. empty leaves placement to the os.
+    std::vector<int> cpu_set;
+    // spread the workers round robin over the NUMA nodes, pin each one to the cpus of its node and give every node
+    // its own lanes. tasks go to the lanes of the submitter's node and workers only take work of other nodes when
+    // their own node has none. without a readable topology the pool runs as a single node.
+    bool numa_aware = false;
+    // the topology numa_aware uses, detected from the system when empty
+    CpuTopology topology;
+    // elastic sizing: the pool starts with concurrency_num workers (at least 1) and adds workers up to
+    // max_concurrency_num while work piles up. a worker that stays parked for idle_timeout_ms retires as long as more
+    // than concurrency_num are running. see ThreadPool::Scaling().
+    bool elastic = false;
+    size_t max_concurrency_num = 0;
+    // a worker is added when nobody is parked and more than scale_up_backlog tasks per running worker are queued,
+    size_t scale_up_backlog = 4;
+    // or when a task waited longer than scale_up_queue_wait_us before it started
+    uint64_t scale_up_queue_wait_us = 1000;
+    uint64_t idle_timeout_ms = 5000;
+};
+
+// scaling decisions of an elastic ThreadPool
+class ScalingCounters {
+public:
+    size_t scale_up_on_backlog = 0;
+    size_t scale_up_on_queue_wait = 0;
+    size_t retired_on_idle = 0;
+    size_t peak_workers = 0;
+};
+
 class ThreadPool {
 public:
-    ThreadPool(size_t concurrency_num) : stop_(false) {
-        this->workers_.reserve(concurrency_num);
-        for (size_t i = 0; i < concurrency_num; ++i)
-            this->workers_.emplace_back([this] {
-                while (1) {
-                    std::function<void()> task = nullptr;
-                    bool ok = this->task_queue_.wait_dequeue_timed(task, 1000);
-                    if (ok && task != nullptr) {
-                        task();
-                        continue;
-                    }
-                    if (this->stop_ && this->task_queue_.size_approx() == 0) {
-                        break;
-                    }
-                }
-            });
+    ThreadPool(size_t concurrency_num) : ThreadPool(MakeOptions(concurrency_num)) {}
+    explicit ThreadPool(const ThreadPoolOptions& options)
+        : options_(options), queue_wait_(new LatencyHistogram[kTaskPriorityNum]), stop_(false) {
+        // every worker the pool may ever run gets a slot up front, an elastic pool starts and retires threads in them
+        size_t start_num = this->options_.concurrency_num;
+        this->slot_num_ = start_num;
+        if (this->options_.elastic) {
+            this->options_.concurrency_num = start_num = std::max<size_t>(1, start_num);
+            this->slot_num_ = std::max(start_num, this->options_.max_concurrency_num);
+        }
+        this->PlaceWorkers();
+        this->nodes_.reset(new NodeQueues[this->node_num_]);
+        if (this->options_.collect_stats || this->options_.trace) {
+            // one more for outside threads running tasks
+            this->stats_.reset(new WorkerStats[this->slot_num_ + 1]);
+        }
+        this->origin_ns_ = MonotonicNowNs();
+        if (this->options_.work_stealing) {
+            this->local_queues_.reserve(this->slot_num_);
+            for (size_t i = 0; i < this->slot_num_; ++i) {
+                this->local_queues_.emplace_back(new WorkStealingQueue<QueuedTask>());
+            }
+        }
+        this->workers_.resize(this->slot_num_);
+        for (size_t i = start_num; i < this->slot_num_; ++i) {
+            this->free_slots_.push_back(i);
+        }
+        this->live_workers_ = start_num;
+        this->peak_workers_ = start_num;
+        for (size_t i = 0; i < start_num; ++i) {
+            this->workers_[i] = std::thread([this, i] { this->WorkerLoop(i); });
+        }
     }
     ~ThreadPool() {
-        this->stop_ = true;
+        // timers still pending are dropped, the ones handed to the workers already run
+        this->StopTimerThread();
+        {
+            // no worker is started once stop_ is set
+            std::lock_guard<std::mutex> lock(this->scale_mutex_);
+            this->stop_ = true;
+        }
+        for (size_t node = 0; node < this->node_num_; ++node) {
+            this->nodes_[node].parker_.Close();
+        }
         for (auto&& t : this->workers_) {
-            t.join();
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+        if (this->options_.trace && !this->options_.trace_path.empty()) {
+            this->WriteTrace(this->options_.trace_path);
         }
     }
 
-#if __cplusplus > 201402L
     template <class F, class... Args>
-    std::future<typename std::invoke_result<F, Args...>::type> Enqueue(F&& f, Args&&... args) {
-        using return_type = typename std::invoke_result<F, Args...>::type;
-#else
+    std::future<TaskResult<F, Args...>> Enqueue(F&& f, Args&&... args) {
+        return this->EnqueueWithPriority(TaskPriority::kNormal, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
     template <class F, class... Args>
-    std::future<typename std::result_of<F(Args...)>::type> Enqueue(F&& f, Args&&... args) {
-        using return_type = typename std::result_of<F(Args...)>::type;
-#endif
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-        std::future<return_type> res = task->get_future();
+    std::future<TaskResult<F, Args...>> EnqueueWithPriority(TaskPriority priority, F&& f, Args&&... args) {
+        using return_type = TaskResult<F, Args...>;
+        // the shared state of the promise comes from a slot pool and the task is stored inline in the queue, so
+        // submitting a small callable does not touch the heap once the pool is warmed up
+        std::promise<return_type> promise(std::allocator_arg, PooledAllocator<return_type>());
+        std::future<return_type> res = promise.get_future();
+        if (this->stop_) throw std::runtime_error("enqueue on stopped ThreadPool");
+        auto task = MakePromiseTask(std::move(promise), std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        if (!this->Submit(std::move(task), priority)) {
+            throw QueueFullError();
+        }
+        return res;
+    }
+
+    // Enqueue() that reports a rejection by the overflow policy with an invalid future instead of throwing
+    template <class F, class... Args>
+    std::future<TaskResult<F, Args...>> TryEnqueue(F&& f, Args&&... args) {
+        return this->TryEnqueueWithPriority(TaskPriority::kNormal, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template <class F, class... Args>
+    std::future<TaskResult<F, Args...>> TryEnqueueWithPriority(TaskPriority priority, F&& f, Args&&... args) {
+        using return_type = TaskResult<F, Args...>;
+        std::promise<return_type> promise(std::allocator_arg, PooledAllocator<return_type>());
+        std::future<return_type> res = promise.get_future();
         if (this->stop_) throw std::runtime_error("enqueue on stopped ThreadPool");
-        task_queue_.enqueue([task]() { (*task)(); });
+        auto task = MakePromiseTask(std::move(promise), std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        if (!this->Submit(std::move(task), priority)) {
+            return std::future<return_type>();
+        }
         return res;
     }
 
+    // fire and forget: no future is created, an exception escaping f terminates the process like std::thread
+    template <class F, class... Args>
+    void Execute(F&& f, Args&&... args) {
+        this->ExecuteWithPriority(TaskPriority::kNormal, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template <class F, class... Args>
+    void ExecuteWithPriority(TaskPriority priority, F&& f, Args&&... args) {
+        if (this->stop_) throw std::runtime_error("execute on stopped ThreadPool");
+        if (!this->Submit(std::bind(std::forward<F>(f), std::forward<Args>(args)...), priority)) {
+            throw QueueFullError();
+        }
+    }
+
+    // Execute() that returns false instead of throwing when the overflow policy rejects the task
+    template <class F, class... Args>
+    bool TryExecute(F&& f, Args&&... args) {
+        if (this->stop_) throw std::runtime_error("execute on stopped ThreadPool");
+        return this->Submit(std::bind(std::forward<F>(f), std::forward<Args>(args)...), TaskPriority::kNormal);
+    }
+
+    // submits every callable in [first, last) with bulk enqueues through one producer token, returns their futures
+    // in order. bulk submissions always go to the shared queue so that every worker can pick them up at once. a
+    // bounded pool applies its overflow policy task by task, a rejection throws QueueFullError and leaves the tasks
+    // before it submitted.
+    template <class Iter>
+    std::vector<std::future<TaskResult<typename std::iterator_traits<Iter>::value_type>>> EnqueueBulk(
+        Iter first, Iter last, TaskPriority priority = TaskPriority::kNormal) {
+        using callable_type = typename std::iterator_traits<Iter>::value_type;
+        using return_type = TaskResult<callable_type>;
+        std::vector<std::future<return_type>> futures;
+        futures.reserve(std::distance(first, last));
+        this->SubmitBulk(first, last, priority, [&futures](const callable_type& f) {
+            std::promise<return_type> promise(std::allocator_arg, PooledAllocator<return_type>());
+            futures.push_back(promise.get_future());
+            return UniqueTask(MakePromiseTask(std::move(promise), callable_type(f)));
+        });
+        return futures;
+    }
+
+    // fire and forget version of EnqueueBulk
+    template <class Iter>
+    void ExecuteBulk(Iter first, Iter last, TaskPriority priority = TaskPriority::kNormal) {
+        using callable_type = typename std::iterator_traits<Iter>::value_type;
+        this->SubmitBulk(first, last, priority, [](const callable_type& f) { return UniqueTask(f); });
+    }
+
+    // running workers, changes over time in an elastic pool
+    size_t Size() const { return this->live_workers_.load(std::memory_order_relaxed); }
+
+    AdmissionCounters Admission() const {
+        AdmissionCounters counters;
+        counters.rejected = this->rejected_.load(std::memory_order_relaxed);
+        counters.blocked = this->blocked_.load(std::memory_order_relaxed);
+        counters.block_timeouts = this->block_timeouts_.load(std::memory_order_relaxed);
+        counters.caller_runs = this->caller_runs_.load(std::memory_order_relaxed);
+        counters.dropped = this->dropped_.load(std::memory_order_relaxed);
+        return counters;
+    }
+
+    ScalingCounters Scaling() const {
+        ScalingCounters counters;
+        counters.scale_up_on_backlog = this->scale_up_on_backlog_.load(std::memory_order_relaxed);
+        counters.scale_up_on_queue_wait = this->scale_up_on_queue_wait_.load(std::memory_order_relaxed);
+        counters.retired_on_idle = this->retired_on_idle_.load(std::memory_order_relaxed);
+        counters.peak_workers = this->peak_workers_.load(std::memory_order_relaxed);
+        return counters;
+    }
+
+    // number of NUMA nodes the workers are spread over, 1 unless options.numa_aware found several
+    size_t NodeNum() const { return this->node_num_; }
+    size_t WorkerNode(size_t index) const { return this->worker_node_[index]; }
+
+    // tasks waiting in the lanes and in the per-worker deques
+    size_t PendingApprox() const {
+        size_t pending = 0;
+        for (size_t node = 0; node < this->node_num_; ++node) {
+            for (auto&& q : this->nodes_[node].lanes_) {
+                pending += q.size_approx();
+            }
+        }
+        for (auto&& q : this->local_queues_) {
+            pending += q->SizeApprox();
+        }
+        return pending;
+    }
+
+    // runs f(args...) on a worker once delay passed. returns an id for CancelTimer(), 0 if the task was due right
+    // away and went to the workers directly. like Execute() nothing is returned and an escaping exception terminates.
+    template <class Rep, class Period, class F, class... Args>
+    TimerId ScheduleAfter(const std::chrono::duration<Rep, Period>& delay, F&& f, Args&&... args) {
+        return this->AddTimer(MonotonicNowNs() + DurationNs(delay), 0,
+                              std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    }
+
+    // ScheduleAfter() for a point in time of any clock, e.g. std::chrono::system_clock
+    template <class Clock, class Duration, class F, class... Args>
+    TimerId ScheduleAt(const std::chrono::time_point<Clock, Duration>& when, F&& f, Args&&... args) {
+        return this->ScheduleAfter(when - Clock::now(), std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    // runs f(args...) every period, the first time one period from now, until the timer is cancelled. a run is
+    // skipped while the previous one is still going.
+    template <class Rep, class Period, class F, class... Args>
+    TimerId ScheduleEvery(const std::chrono::duration<Rep, Period>& period, F&& f, Args&&... args) {
+        uint64_t period_ns = std::max<uint64_t>(1, DurationNs(period));
+        return this->AddTimer(MonotonicNowNs() + period_ns, period_ns,
+                              std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    }
+
+    // returns false if the timer already fired (a one shot timer) or was cancelled before
+    bool CancelTimer(TimerId id) {
+        std::lock_guard<std::mutex> lock(this->timer_mutex_);
+        return this->timers_.Cancel(id);
+    }
+
+    size_t PendingTimers() const {
+        std::lock_guard<std::mutex> lock(this->timer_mutex_);
+        return this->timers_.Size();
+    }
+
+#if defined(__cpp_impl_coroutine)
+    class ScheduleAwaiter {
+    public:
+        explicit ScheduleAwaiter(ThreadPool* pool) : pool_(pool) {}
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            this->pool_->ExecuteInternal([handle]() { handle.resume(); });
+        }
+        void await_resume() const noexcept {}
+
+    private:
+        ThreadPool* pool_;
+    };
+
+    // `co_await pool.Schedule()` resumes the calling coroutine on a worker of this pool
+    ScheduleAwaiter Schedule() { return ScheduleAwaiter(this); }
+#endif
+
+    // runs one queued task on the calling thread, returns false when there was none. a thread waiting for work it
+    // submitted calls this in a loop to help out instead of blocking a thread the pool may need.
+    bool RunPendingTask() {
+        const WorkerContext& ctx = CurrentWorker();
+        size_t index = kNoWorker;
+        if (ctx.pool == this) {
+            index = ctx.index;
+        }
+        QueuedTask task;
+        for (size_t lane = 0; lane < kTaskPriorityNum; ++lane) {
+            if (this->TryPopLane(index, lane, task)) {
+                this->RunTask(index, task);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // histograms and counters of every worker merged, only filled with options.collect_stats
+    ThreadPoolStats Stats() const {
+        ThreadPoolStats stats;
+        stats.queue_depth = this->PendingApprox();
+        stats.workers = this->Size();
+        if (this->stats_ == nullptr) {
+            return stats;
+        }
+        for (size_t i = 0; i <= this->slot_num_; ++i) {
+            const WorkerStats& worker = this->stats_[i];
+            WorkerStatsSnapshot snapshot;
+            snapshot.tasks = worker.tasks_.load(std::memory_order_relaxed);
+            snapshot.busy_ns = worker.busy_ns_.load(std::memory_order_relaxed);
+            snapshot.idle_ns = worker.idle_ns_.load(std::memory_order_relaxed);
+            stats.tasks_executed += snapshot.tasks;
+            stats.queue_wait.Merge(worker.queue_wait_);
+            stats.exec_time.Merge(worker.exec_time_);
+            stats.per_worker.push_back(snapshot);
+        }
+        return stats;
+    }
+
+    void ResetStats() {
+        if (this->stats_ == nullptr) {
+            return;
+        }
+        for (size_t i = 0; i <= this->slot_num_; ++i) {
+            WorkerStats& worker = this->stats_[i];
+            worker.tasks_.store(0, std::memory_order_relaxed);
+            worker.busy_ns_.store(0, std::memory_order_relaxed);
+            worker.idle_ns_.store(0, std::memory_order_relaxed);
+            worker.queue_wait_.Reset();
+            worker.exec_time_.Reset();
+        }
+    }
+
+    // writes the tasks recorded so far with options.trace as a chrome trace-event json file
+    bool WriteTrace(const std::string& path) const {
+        std::vector<std::vector<TaskTraceEvent>> events;
+        for (size_t i = 0; this->stats_ != nullptr && i <= this->slot_num_; ++i) {
+            std::lock_guard<std::mutex> lock(this->stats_[i].trace_mutex_);
+            events.push_back(this->stats_[i].trace_);
+        }
+        return WriteChromeTrace(path, events, this->origin_ns_);
+    }
+
+    // time between submission and start of the tasks of one lane, only filled with options.track_queue_wait
+    const LatencyHistogram& QueueWaitHistogram(TaskPriority priority) const {
+        return this->queue_wait_[static_cast<size_t>(priority)];
+    }
+
+private:
+    static const size_t kBulkBatchSize = 64;
+    static const size_t kNoWorker = static_cast<size_t>(-1);
+
+    class QueuedTask {
+    public:
+        QueuedTask() = default;
+        QueuedTask(UniqueTask&& fn, TaskPriority priority, uint64_t enqueue_ns, bool internal = false)
+            : fn_(std::move(fn)), enqueue_ns_(enqueue_ns), priority_(priority), internal_(internal) {}
+
+        UniqueTask fn_;
+        uint64_t enqueue_ns_ = 0;
+        TaskPriority priority_ = TaskPriority::kNormal;
+        // a task of the pool itself (a timer firing, a coroutine resuming) that kDropOldest must not drop
+        bool internal_ = false;
+    };
+
+    template <typename R, typename F>
+    class PromiseTask {
+    public:
+        PromiseTask(std::promise<R>&& promise, F&& fn) : promise_(std::move(promise)), fn_(std::move(fn)) {}
+        void operator()() {
+            try {
+                Fulfill(this->promise_, this->fn_);
+            } catch (...) {
+                this->promise_.set_exception(std::current_exception());
+            }
+        }
+
+    private:
+        template <typename T>
+        static void Fulfill(std::promise<T>& promise, F& fn) {
+            promise.set_value(fn());
+        }
+        static void Fulfill(std::promise<void>& promise, F& fn) {
+            fn();
+            promise.set_value();
+        }
+
+        std::promise<R> promise_;
+        F fn_;
+    };
+
+    template <typename R, typename F>
+    static PromiseTask<R, F> MakePromiseTask(std::promise<R>&& promise, F&& fn) {
+        return PromiseTask<R, F>(std::move(promise), std::move(fn));
+    }
+
+    struct WorkerContext {
+        const ThreadPool* pool;
+        size_t index;
+    };
+
+    class PeriodicTask {
+    public:
+        explicit PeriodicTask(UniqueTask&& fn) : fn_(std::move(fn)) {}
+        UniqueTask fn_;
+        std::atomic<bool> running_{false};
+    };
+
+    // one run of a periodic timer on a worker. the next run is allowed once it is gone, also when it is destroyed
+    // without running
+    class PeriodicRun {
+    public:
+        explicit PeriodicRun(std::shared_ptr<PeriodicTask> periodic) : periodic_(std::move(periodic)) {}
+        PeriodicRun(PeriodicRun&&) = default;
+        ~PeriodicRun() {
+            if (this->periodic_ != nullptr) {
+                this->periodic_->running_ = false;
+            }
+        }
+        // lets go of the state right after the run, a task destroyed later must not end the next run
+        void operator()() {
+            std::shared_ptr<PeriodicTask> periodic = std::move(this->periodic_);
+            periodic->fn_();
+            periodic->running_ = false;
+        }
+
+    private:
+        std::shared_ptr<PeriodicTask> periodic_;
+    };
+
+    // what the timing wheel holds: the task itself for a one shot timer, a shared state for a periodic one
+    class TimerTask {
+    public:
+        UniqueTask fn_;
+        std::shared_ptr<PeriodicTask> periodic_;
+    };
+
+    class NodeQueues {
+    public:
+        moodycamel::ConcurrentQueue<QueuedTask> lanes_[kTaskPriorityNum];
+        Parker parker_;
+    };
+
+    static ThreadPoolOptions MakeOptions(size_t concurrency_num) {
+        ThreadPoolOptions options;
+        options.concurrency_num = concurrency_num;
+        return options;
+    }
+
+    static WorkerContext& CurrentWorker() {
+        static thread_local WorkerContext ctx{nullptr, 0};
+        return ctx;
+    }
+
+    template <class Rep, class Period>
+    static uint64_t DurationNs(const std::chrono::duration<Rep, Period>& d) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        return ns > 0 ? static_cast<uint64_t>(ns) : 0;
+    }
+
+    uint64_t TimerTickNs() const { return std::max<uint64_t>(1, this->options_.timer_tick_us * 1000); }
+
+    TimerId AddTimer(uint64_t deadline_ns, uint64_t period_ns, UniqueTask&& fn) {
+        if (this->stop_) throw std::runtime_error("schedule on stopped ThreadPool");
+        uint64_t tick_ns = this->TimerTickNs();
+        // rounded up, so a task never starts early
+        uint64_t expire = (deadline_ns - this->origin_ns_ + tick_ns - 1) / tick_ns;
+        uint64_t period = 0;
+        TimerTask timer;
+        if (period_ns > 0) {
+            period = std::max<uint64_t>(1, (period_ns + tick_ns / 2) / tick_ns);
+            timer.periodic_ = std::make_shared<PeriodicTask>(std::move(fn));
+        } else {
+            timer.fn_ = std::move(fn);
+        }
+        std::unique_lock<std::mutex> lock(this->timer_mutex_);
+        if (!this->timer_thread_.joinable()) {
+            this->timer_thread_ = std::thread([this] { this->TimerLoop(); });
+        }
+        if (period > 0) {
+            expire = std::max(expire, this->timers_.CurrentTick() + 1);
+        }
+        TimerId id = this->timers_.Add(expire, period, std::move(timer));
+        if (id == TimingWheel<TimerTask>::kInvalidId) {
+            // already due, the wheel left the task alone
+            lock.unlock();
+            this->PushTimerTask(std::move(timer.fn_));
+            return id;
+        }
+        if (expire < this->timer_wake_tick_) {
+            this->timer_cv_.notify_one();
+        }
+        return id;
+    }
+
+    void TimerLoop() {
+        uint64_t tick_ns = this->TimerTickNs();
+        std::vector<UniqueTask> due;
+        std::unique_lock<std::mutex> lock(this->timer_mutex_);
+        while (!this->timer_stop_) {
+            // awake, an added timer needs no notification
+            this->timer_wake_tick_ = 0;
+            this->timers_.Advance((MonotonicNowNs() - this->origin_ns_) / tick_ns, [&due](TimerTask& timer, bool) {
+                if (timer.periodic_ == nullptr) {
+                    due.push_back(std::move(timer.fn_));
+                } else if (!timer.periodic_->running_.exchange(true)) {
+                    std::shared_ptr<PeriodicTask> periodic = timer.periodic_;
+                    due.push_back(PeriodicRun(std::move(periodic)));
+                }
+            });
+            if (!due.empty()) {
+                lock.unlock();
+                for (auto& fn : due) {
+                    this->PushTimerTask(std::move(fn));
+                }
+                due.clear();
+                lock.lock();
+                continue;
+            }
+            this->timer_wake_tick_ = this->timers_.NextTick();
+            if (this->timer_wake_tick_ == std::numeric_limits<uint64_t>::max()) {
+                this->timer_cv_.wait(lock);
+            } else {
+                auto wake_ns = std::chrono::nanoseconds(this->origin_ns_ + this->timer_wake_tick_ * tick_ns);
+                this->timer_cv_.wait_until(lock, std::chrono::steady_clock::time_point(wake_ns));
+            }
+        }
+    }
+
+    // due timers skip the overflow policy but still count against the capacity
+    void PushTimerTask(UniqueTask&& fn) {
+        if (this->options_.queue_capacity > 0) {
+            this->queued_.fetch_add(1);
+        }
+        this->Push(std::move(fn), TaskPriority::kNormal, true);
+    }
+
+    void StopTimerThread() {
+        {
+            std::lock_guard<std::mutex> lock(this->timer_mutex_);
+            this->timer_stop_ = true;
+        }
+        this->timer_cv_.notify_one();
+        if (this->timer_thread_.joinable()) {
+            this->timer_thread_.join();
+        }
+    }
+
+    uint64_t EnqueueTimestamp() const {
+        const ThreadPoolOptions& o = this->options_;
+        return o.track_queue_wait || o.elastic || o.collect_stats || o.trace ? MonotonicNowNs() : 0;
+    }
+
+    void PlaceWorkers() {
+        size_t n = this->slot_num_;
+        const std::vector<int>& cpu_set = this->options_.cpu_set;
+        this->node_num_ = 1;
+        this->worker_node_.assign(n, 0);
+        this->worker_cpus_.assign(n, std::vector<int>());
+        if (this->options_.numa_aware && n > 0) {
+            CpuTopology topology = this->options_.topology.Empty() ? CpuTopology::Detect() : this->options_.topology;
+            if (!cpu_set.empty()) {
+                topology = topology.Restrict(cpu_set);
+            }
+            if (!topology.Empty()) {
+                // nodes beyond the worker count would get no worker, leave them out
+                this->node_num_ = std::min(topology.NodeNum(), n);
+                for (size_t i = 0; i < n; ++i) {
+                    this->worker_node_[i] = i % this->node_num_;
+                    this->worker_cpus_[i] = topology.NodeCpus(this->worker_node_[i]);
+                }
+                this->topology_ = std::move(topology);
+                return;
+            }
+        }
+        if (!cpu_set.empty()) {
+            for (size_t i = 0; i < n; ++i) {
+                this->worker_cpus_[i].assign(1, cpu_set[i % cpu_set.size()]);
+            }
+        }
+    }
+
+    // the node a task submitted by the calling thread belongs to
+    size_t SubmitterNode() const {
+        if (this->node_num_ == 1) {
+            return 0;
+        }
+        const WorkerContext& ctx = CurrentWorker();
+        if (ctx.pool == this) {
+            return this->worker_node_[ctx.index];
+        }
+        int node = this->topology_.NodeOfCpu(CurrentCpu());
+        return node < 0 ? 0 : static_cast<size_t>(node) % this->node_num_;
+    }
+
+    // wakes n workers, the ones of node first. other nodes are only woken when node has nobody parked.
+    void Notify(size_t node, size_t n) {
+        for (size_t i = 0; i < this->node_num_ && n > 0; ++i) {
+            n -= this->nodes_[(node + i) % this->node_num_].parker_.Notify(n);
+        }
+    }
+
+    void Push(UniqueTask&& fn, TaskPriority priority, bool internal = false) {
+        QueuedTask task(std::move(fn), priority, this->EnqueueTimestamp(), internal);
+        const WorkerContext& ctx = CurrentWorker();
+        size_t node = this->SubmitterNode();
+        if (priority == TaskPriority::kNormal && ctx.pool == this && !this->local_queues_.empty()) {
+            this->local_queues_[ctx.index]->PushBack(std::move(task));
+        } else {
+            this->nodes_[node].lanes_[static_cast<size_t>(priority)].enqueue(std::move(task));
+        }
+        this->Notify(node, 1);
+        this->ScaleUpOnBacklog();
+    }
+
+    template <class Iter, class MakeTask>
+    void SubmitBulk(Iter first, Iter last, TaskPriority priority, MakeTask&& make_task) {
+        if (this->stop_) throw std::runtime_error("enqueue on stopped ThreadPool");
+        size_t node = this->SubmitterNode();
+        auto& queue = this->nodes_[node].lanes_[static_cast<size_t>(priority)];
+        QueuedTask batch[kBulkBatchSize];
+        moodycamel::ProducerToken token(queue);
+        size_t n = 0;
+        auto flush = [&] {
+            if (n == 0) {
+                return;
+            }
+            queue.enqueue_bulk(token, std::make_move_iterator(batch), n);
+            this->Notify(node, n);
+            n = 0;
+        };
+        bool rejected = false;
+        while (first != last && !rejected) {
+            uint64_t enqueue_ns = this->EnqueueTimestamp();
+            for (; n < kBulkBatchSize && first != last && !rejected; ++first) {
+                UniqueTask fn = make_task(*first);
+                AdmitResult admit = AdmitResult::kQueued;
+                if (this->options_.queue_capacity > 0 && !this->TryReserve()) {
+                    // the overflow policy may wait for room or drop queued tasks, the places held by the batch are
+                    // only freed once it is in the queue
+                    flush();
+                    admit = this->Admit();
+                }
+                if (admit == AdmitResult::kQueued) {
+                    batch[n++] = QueuedTask(std::move(fn), priority, enqueue_ns);
+                } else if (admit == AdmitResult::kRunInline) {
+                    fn();
+                } else {
+                    rejected = true;
+                }
+            }
+            flush();
+        }
+        this->ScaleUpOnBacklog();
+        if (rejected) {
+            throw QueueFullError();
+        }
+    }
+
+    enum class AdmitResult {
+        kQueued,
+        kRunInline,
+        kRejected,
+    };
+
+    // Execute() for a task of the pool itself, which the overflow policy may reject but kDropOldest never drops
+    void ExecuteInternal(UniqueTask&& fn) {
+        if (this->stop_) throw std::runtime_error("execute on stopped ThreadPool");
+        if (!this->Submit(std::move(fn), TaskPriority::kNormal, true)) {
+            throw QueueFullError();
+        }
+    }
+
+    // queues task or runs it inline as the overflow policy says, returns false if it was rejected
+    template <class Task>
+    bool Submit(Task&& task, TaskPriority priority, bool internal = false) {
+        AdmitResult admit = this->Admit();
+        if (admit == AdmitResult::kQueued) {
+            this->Push(std::forward<Task>(task), priority, internal);
+        } else if (admit == AdmitResult::kRunInline) {
+            task();
+        }
+        return admit != AdmitResult::kRejected;
+    }
+
+    // takes a place in a bounded queue, or applies the overflow policy when there is none
+    AdmitResult Admit() {
+        if (this->options_.queue_capacity == 0 || this->TryReserve()) {
+            return AdmitResult::kQueued;
+        }
+        switch (this->options_.overflow_policy) {
+            case OverflowPolicy::kReject:
+                break;
+            case OverflowPolicy::kCallerRuns:
+                this->caller_runs_.fetch_add(1, std::memory_order_relaxed);
+                return AdmitResult::kRunInline;
+            case OverflowPolicy::kDropOldest:
+                while (!this->TryReserve()) {
+                    if (this->DropOldest()) {
+                        this->dropped_.fetch_add(1, std::memory_order_relaxed);
+                    } else {
+                        // the queued tasks are still on their way into the queues
+                        std::this_thread::yield();
+                    }
+                }
+                return AdmitResult::kQueued;
+            case OverflowPolicy::kBlock:
+                if (CurrentWorker().pool == this) {
+                    this->caller_runs_.fetch_add(1, std::memory_order_relaxed);
+                    return AdmitResult::kRunInline;
+                }
+                this->blocked_.fetch_add(1, std::memory_order_relaxed);
+                if (this->WaitForRoom()) {
+                    return AdmitResult::kQueued;
+                }
+                this->block_timeouts_.fetch_add(1, std::memory_order_relaxed);
+                break;
+        }
+        this->rejected_.fetch_add(1, std::memory_order_relaxed);
+        return AdmitResult::kRejected;
+    }
+
+    bool TryReserve() {
+        size_t queued = this->queued_.load(std::memory_order_relaxed);
+        while (queued < this->options_.queue_capacity) {
+            if (this->queued_.compare_exchange_weak(queued, queued + 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // gives the place of a dequeued task back and hands it to a blocked submitter
+    void Release() {
+        this->queued_.fetch_sub(1);
+        if (this->space_waiters_.load() > 0) {
+            std::lock_guard<std::mutex> lock(this->space_mutex_);
+            this->space_cv_.notify_one();
+        }
+    }
+
+    bool WaitForRoom() {
+        std::unique_lock<std::mutex> lock(this->space_mutex_);
+        this->space_waiters_.fetch_add(1);
+        bool reserved = true;
+        if (this->options_.block_timeout_us == 0) {
+            this->space_cv_.wait(lock, [this] { return this->TryReserve(); });
+        } else {
+            reserved = this->space_cv_.wait_for(lock, std::chrono::microseconds(this->options_.block_timeout_us),
+                                                [this] { return this->TryReserve(); });
+        }
+        this->space_waiters_.fetch_sub(1);
+        return reserved;
+    }
+
+    // removes the oldest task of the lowest lane that has one, the task is destroyed without running. internal
+    // tasks met on the way are set aside and queued again on the normal lane of their node.
+    bool DropOldest() {
+        std::vector<std::pair<size_t, QueuedTask>> kept;
+        bool dropped = false;
+        QueuedTask task;
+        auto take = [&](size_t node) {
+            if (task.internal_) {
+                kept.emplace_back(node, std::move(task));
+                return false;
+            }
+            task = QueuedTask();
+            this->Release();
+            return true;
+        };
+        for (size_t lane = kTaskPriorityNum; lane-- > 0 && !dropped;) {
+            for (size_t node = 0; node < this->node_num_ && !dropped; ++node) {
+                while (!dropped && this->nodes_[node].lanes_[lane].try_dequeue(task)) {
+                    dropped = take(node);
+                }
+            }
+            if (lane != static_cast<size_t>(TaskPriority::kNormal)) {
+                continue;
+            }
+            for (size_t i = 0; i < this->local_queues_.size() && !dropped; ++i) {
+                while (!dropped && this->local_queues_[i]->StealFront(task)) {
+                    dropped = take(this->worker_node_[i]);
+                }
+            }
+        }
+        for (auto& entry : kept) {
+            size_t lane = static_cast<size_t>(TaskPriority::kNormal);
+            this->nodes_[entry.first].lanes_[lane].enqueue(std::move(entry.second));
+            this->Notify(entry.first, 1);
+        }
+        return dropped;
+    }
+
+    size_t WaitersApprox() const {
+        size_t waiters = 0;
+        for (size_t node = 0; node < this->node_num_; ++node) {
+            waiters += this->nodes_[node].parker_.WaitersApprox();
+        }
+        return waiters;
+    }
+
+    void ScaleUpOnBacklog() {
+        if (!this->options_.elastic) {
+            return;
+        }
+        size_t live = this->live_workers_.load(std::memory_order_relaxed);
+        if (live >= this->slot_num_ || this->WaitersApprox() > 0) {
+            return;
+        }
+        if (this->PendingApprox() > this->options_.scale_up_backlog * live && this->TryStartWorker()) {
+            this->scale_up_on_backlog_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // starts a worker in a free slot, never blocks a submitter on another one scaling
+    bool TryStartWorker() {
+        std::unique_lock<std::mutex> lock(this->scale_mutex_, std::try_to_lock);
+        if (!lock.owns_lock() || this->stop_ || this->free_slots_.empty()) {
+            return false;
+        }
+        size_t index = this->free_slots_.back();
+        this->free_slots_.pop_back();
+        if (this->workers_[index].joinable()) {
+            // the thread that retired from this slot is gone or about to be
+            this->workers_[index].join();
+        }
+        this->workers_[index] = std::thread([this, index] { this->WorkerLoop(index); });
+        size_t live = this->live_workers_.fetch_add(1) + 1;
+        if (live > this->peak_workers_.load(std::memory_order_relaxed)) {
+            this->peak_workers_.store(live, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // called by an idle worker whose park timed out, returns true if it has to exit
+    bool TryRetire(size_t index) {
+        std::lock_guard<std::mutex> lock(this->scale_mutex_);
+        // a task that arrived meanwhile may have nobody else to wake, keep going then
+        if (this->stop_ || this->live_workers_.load() <= this->options_.concurrency_num || this->PendingApprox() > 0) {
+            return false;
+        }
+        this->live_workers_.fetch_sub(1);
+        this->free_slots_.push_back(index);
+        this->retired_on_idle_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // index is the calling worker, kNoWorker for other threads which have no deque of their own
+    bool TryPopLane(size_t index, size_t lane, QueuedTask& task) {
+        bool stealing = lane == static_cast<size_t>(TaskPriority::kNormal) && !this->local_queues_.empty();
+        if (stealing && index != kNoWorker && this->local_queues_[index]->PopBack(task)) {
+            return true;
+        }
+        size_t home = this->SubmitterNode();
+        if (index != kNoWorker) {
+            home = this->worker_node_[index];
+        }
+        // the own node first, the other nodes only as a fallback
+        for (size_t i = 0; i < this->node_num_; ++i) {
+            size_t node = (home + i) % this->node_num_;
+            if (this->nodes_[node].lanes_[lane].try_dequeue(task)) {
+                return true;
+            }
+            if (stealing && this->StealFromNode(index, node, task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool StealFromNode(size_t index, size_t node, QueuedTask& task) {
+        size_t n = this->local_queues_.size();
+        for (size_t i = 1; i <= n; ++i) {
+            size_t victim = (index + i) % n;
+            if (victim == index || this->worker_node_[victim] != node) {
+                continue;
+            }
+            if (this->local_queues_[victim]->StealFront(task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // index is the running worker, kNoWorker for outside threads
+    void RunTask(size_t index, QueuedTask& task) {
+        if (this->options_.queue_capacity > 0) {
+            this->Release();
+        }
+        uint64_t start_ns = 0;
+        if (task.enqueue_ns_ != 0) {
+            start_ns = MonotonicNowNs();
+            uint64_t wait_ns = start_ns - task.enqueue_ns_;
+            if (this->options_.track_queue_wait) {
+                this->queue_wait_[static_cast<size_t>(task.priority_)].Record(wait_ns);
+            }
+            if (this->options_.elastic && wait_ns > this->options_.scale_up_queue_wait_us * 1000 &&
+                this->live_workers_.load(std::memory_order_relaxed) < this->slot_num_ && this->TryStartWorker()) {
+                this->scale_up_on_queue_wait_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (task.fn_ != nullptr) {
+            task.fn_();
+        }
+        if (this->stats_ != nullptr) {
+            this->RecordTask(index, task, start_ns, MonotonicNowNs());
+        }
+    }
+
+    void RecordTask(size_t index, const QueuedTask& task, uint64_t start_ns, uint64_t end_ns) {
+        WorkerStats& stats = this->stats_[index == kNoWorker ? this->slot_num_ : index];
+        if (this->options_.collect_stats) {
+            if (index != kNoWorker) {
+                this->RecordIdle(stats, start_ns);
+                stats.idle_since_ns_ = end_ns;
+            }
+            stats.tasks_.fetch_add(1, std::memory_order_relaxed);
+            stats.busy_ns_.fetch_add(end_ns - start_ns, std::memory_order_relaxed);
+            stats.queue_wait_.Record(start_ns - task.enqueue_ns_);
+            stats.exec_time_.Record(end_ns - start_ns);
+        }
+        if (this->options_.trace) {
+            std::lock_guard<std::mutex> lock(stats.trace_mutex_);
+            if (stats.trace_.size() < this->options_.trace_max_events) {
+                TaskTraceEvent event;
+                event.enqueue_ns = task.enqueue_ns_;
+                event.start_ns = start_ns;
+                event.end_ns = end_ns;
+                event.lane = static_cast<uint8_t>(task.priority_);
+                stats.trace_.push_back(event);
+            }
+        }
+    }
+
+    // idle time is what a worker spends between tasks: polling, yielding and parked
+    static void RecordIdle(WorkerStats& stats, uint64_t now_ns) {
+        stats.idle_ns_.fetch_add(now_ns - stats.idle_since_ns_, std::memory_order_relaxed);
+    }
+
+    bool TryPop(size_t index, size_t& ticks, QueuedTask& task) {
+        size_t interval = this->options_.starvation_interval;
+        if (interval > 0 && ++ticks % interval == 0) {
+            size_t lane = 1 + (ticks / interval) % (kTaskPriorityNum - 1);
+            if (this->TryPopLane(index, lane, task)) {
+                return true;
+            }
+        }
+        for (size_t lane = 0; lane < kTaskPriorityNum; ++lane) {
+            if (this->TryPopLane(index, lane, task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WorkerLoop(size_t index) {
+        CurrentWorker() = WorkerContext{this, index};
+        if (!this->worker_cpus_[index].empty()) {
+            // a refused or unsupported affinity leaves the worker unpinned
+            PinCurrentThread(this->worker_cpus_[index]);
+        }
+        Parker& parker = this->nodes_[this->worker_node_[index]].parker_;
+        size_t idle_rounds = 0;
+        size_t ticks = 0;
+        if (this->options_.collect_stats) {
+            this->stats_[index].idle_since_ns_ = MonotonicNowNs();
+        }
+        while (1) {
+            QueuedTask task;
+            if (this->TryPop(index, ticks, task)) {
+                idle_rounds = 0;
+                this->RunTask(index, task);
+                continue;
+            }
+            if (this->stop_ && this->PendingApprox() == 0) {
+                break;
+            }
+            if (idle_rounds < this->options_.spin_count) {
+                ++idle_rounds;
+                CpuRelax();
+                continue;
+            }
+            if (idle_rounds < this->options_.spin_count + this->options_.yield_count) {
+                ++idle_rounds;
+                std::this_thread::yield();
+                continue;
+            }
+            parker.PrepareWait();
+            if (this->PendingApprox() > 0 || this->stop_) {
+                parker.CancelWait();
+                continue;
+            }
+            if (!this->options_.elastic) {
+                parker.Wait();
+            } else if (!parker.WaitFor(std::chrono::milliseconds(this->options_.idle_timeout_ms)) &&
+                       this->TryRetire(index)) {
+                break;
+            }
+        }
+        if (this->options_.collect_stats) {
+            this->RecordIdle(this->stats_[index], MonotonicNowNs());
+        }
+        CurrentWorker() = WorkerContext{nullptr, 0};
+    }
+
 private:
+    ThreadPoolOptions options_;
     std::vector<std::thread> workers_;
-    moodycamel::BlockingConcurrentQueue<std::function<void()>> task_queue_;
+    size_t slot_num_ = 0;
+    std::mutex scale_mutex_;
+    std::vector<size_t> free_slots_;
+    std::atomic<size_t> live_workers_{0};
+    std::atomic<size_t> peak_workers_{0};
+    std::atomic<size_t> scale_up_on_backlog_{0};
+    std::atomic<size_t> scale_up_on_queue_wait_{0};
+    std::atomic<size_t> retired_on_idle_{0};
+    CpuTopology topology_;
+    size_t node_num_ = 1;
+    std::vector<size_t> worker_node_;
+    std::vector<std::vector<int>> worker_cpus_;
+    std::unique_ptr<NodeQueues[]> nodes_;
+    std::vector<std::unique_ptr<WorkStealingQueue<QueuedTask>>> local_queues_;
+    std::unique_ptr<LatencyHistogram[]> queue_wait_;
+    std::unique_ptr<WorkerStats[]> stats_;
+    uint64_t origin_ns_ = 0;
+    std::atomic<size_t> queued_{0};
+    std::mutex space_mutex_;
+    std::condition_variable space_cv_;
+    std::atomic<size_t> space_waiters_{0};
+    std::atomic<size_t> rejected_{0};
+    std::atomic<size_t> blocked_{0};
+    std::atomic<size_t> block_timeouts_{0};
+    std::atomic<size_t> caller_runs_{0};
+    std::atomic<size_t> dropped_{0};
+    mutable std::mutex timer_mutex_;
+    std::condition_variable timer_cv_;
+    TimingWheel<TimerTask> timers_;
+    std::thread timer_thread_;
+    uint64_t timer_wake_tick_ = 0;
+    bool timer_stop_ = false;
     std::atomic<bool> stop_;
 };
 
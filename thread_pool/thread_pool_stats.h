@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "thread_pool/latency_histogram.h"
+
+namespace med {
+
+static const size_t kCacheLineSize = 64;
+
+// one task as it shows up in a chrome trace, times are MonotonicNowNs()
+class TaskTraceEvent {
+public:
+    uint64_t enqueue_ns = 0;
+    uint64_t start_ns = 0;
+    uint64_t end_ns = 0;
+    uint8_t lane = 0;
+};
+
+// Counters of one worker. Only its owner writes them (tasks run by outside threads share an extra instance), and
+// the hot counters are padded off the neighbouring workers' cache lines, so collecting them adds no contention.
+class WorkerStats {
+public:
+    std::atomic<uint64_t> tasks_{0};
+    std::atomic<uint64_t> busy_ns_{0};
+    std::atomic<uint64_t> idle_ns_{0};
+    // end of the last task, touched by the owner only
+    uint64_t idle_since_ns_ = 0;
+    LatencyHistogram queue_wait_;
+    LatencyHistogram exec_time_;
+    // only contended while a trace is written
+    std::mutex trace_mutex_;
+    std::vector<TaskTraceEvent> trace_;
+
+private:
+    char padding_[kCacheLineSize];
+};
+
+class WorkerStatsSnapshot {
+public:
+    uint64_t tasks = 0;
+    uint64_t busy_ns = 0;
+    uint64_t idle_ns = 0;
+
+    // fraction of the time the worker spent running tasks
+    double Utilization() const {
+        return busy_ns + idle_ns == 0 ? 0 : static_cast<double>(busy_ns) / (busy_ns + idle_ns);
+    }
+};
+
+// a snapshot of ThreadPool::Stats(), the counters are read one by one while the pool keeps running
+class ThreadPoolStats {
+public:
+    uint64_t tasks_executed = 0;
+    size_t queue_depth = 0;
+    size_t workers = 0;
+    // time between submission and start, and the run time of the tasks
+    LatencyHistogram queue_wait;
+    LatencyHistogram exec_time;
+    // one entry per worker slot, the last one holds the tasks run by outside threads through RunPendingTask()
+    std::vector<WorkerStatsSnapshot> per_worker;
+};
+
+// writes the events of every worker as a chrome trace-event json file (chrome://tracing, perfetto), one complete
+// event per task with its worker as thread id. returns false if the file can not be written.
+inline bool WriteChromeTrace(const std::string& path, const std::vector<std::vector<TaskTraceEvent>>& workers,
+                             uint64_t origin_ns) {
+    static const char* kLaneNames[] = {"high", "normal", "low"};
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fprintf(file, "{\"traceEvents\":[");
+    const char* separator = "\n";
+    for (size_t tid = 0; tid < workers.size(); ++tid) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,", separator, tid);
+        std::fprintf(file, "\"args\":{\"name\":\"%s %zu\"}}", tid + 1 == workers.size() ? "outside" : "worker", tid);
+        separator = ",\n";
+        for (auto& event : workers[tid]) {
+            std::fprintf(file,
+                         ",\n{\"name\":\"task\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,"
+                         "\"dur\":%.3f,\"args\":{\"queue_wait_us\":%.3f}}",
+                         kLaneNames[event.lane % 3], tid, (event.start_ns - origin_ns) / 1e3,
+                         (event.end_ns - event.start_ns) / 1e3, (event.start_ns - event.enqueue_ns) / 1e3);
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
+
+}  // namespace med
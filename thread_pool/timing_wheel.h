@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace med {
+
+// A hierarchical timing wheel in the style of the classic Linux kernel timers. kLevelNum wheels of kSlotNum slots
+// each cover kSlotNum ^ (level + 1) ticks; a timer lives in the slot of the coarsest level that still separates it
+// from now and moves down a level whenever the wheel below wraps around. Slots are intrusive doubly linked lists
+// over a chunked node array, so adding and cancelling a timer are O(1) and a timer costs one node, never a heap
+// allocation of its own once the array is warm. Not thread safe.
+template <typename T>
+class TimingWheel {
+public:
+    static const int kSlotBits = 6;
+    static const uint64_t kSlotNum = uint64_t(1) << kSlotBits;
+    static const int kLevelNum = 4;
+    static const uint64_t kInvalidId = 0;
+
+    TimingWheel() {
+        for (auto& level : this->slots_) {
+            for (auto& head : level) {
+                head = kNil;
+            }
+        }
+    }
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    uint64_t CurrentTick() const { return this->current_; }
+    size_t Size() const { return this->size_; }
+
+    // adds a timer expiring at expire_tick and then every period_ticks (0 for a one shot timer). returns its id, or
+    // kInvalidId if expire_tick is not after the current tick: such a timer is due right away and is not added.
+    uint64_t Add(uint64_t expire_tick, uint64_t period_ticks, T&& payload) {
+        if (expire_tick <= this->current_) {
+            return kInvalidId;
+        }
+        uint32_t index = this->AllocNode();
+        Node& node = this->NodeAt(index);
+        node.payload_ = std::move(payload);
+        node.expire_ = expire_tick;
+        node.period_ = period_ticks;
+        this->Link(index);
+        ++this->size_;
+        return MakeId(node.generation_, index);
+    }
+
+    // removes a pending timer, returns false if it already fired (for good) or was cancelled
+    bool Cancel(uint64_t id) {
+        uint32_t index = static_cast<uint32_t>(id);
+        if (id == kInvalidId || index >= this->capacity_) {
+            return false;
+        }
+        Node& node = this->NodeAt(index);
+        if (node.generation_ != static_cast<uint32_t>(id >> 32) || !node.linked_) {
+            return false;
+        }
+        this->Unlink(index);
+        this->FreeNode(index);
+        --this->size_;
+        return true;
+    }
+
+    // the next tick Advance() has something to do at: the tick of the first slot with timers on any level, where
+    // level 0 timers expire and higher level timers move down. the maximum value when the wheel is empty.
+    uint64_t NextTick() const {
+        uint64_t next = std::numeric_limits<uint64_t>::max();
+        for (int level = 0; level < kLevelNum; ++level) {
+            uint64_t occupied = this->occupied_[level];
+            if (occupied == 0) {
+                continue;
+            }
+            int shift = kSlotBits * level;
+            uint64_t current_slot = (this->current_ >> shift) & (kSlotNum - 1);
+            uint64_t rotation = (this->current_ >> (shift + kSlotBits)) << (shift + kSlotBits);
+            uint64_t later = current_slot + 1 < kSlotNum ? occupied >> (current_slot + 1) : 0;
+            uint64_t tick = 0;
+            if (later != 0) {
+                tick = rotation + ((current_slot + 1 + __builtin_ctzll(later)) << shift);
+            } else {
+                // only slots at or before the current one, they come around in the next rotation
+                tick = rotation + (kSlotNum << shift) + (uint64_t(__builtin_ctzll(occupied)) << shift);
+            }
+            next = std::min(next, tick);
+        }
+        return next;
+    }
+
+    // moves the wheel to now_tick and calls fire(payload, periodic) for every timer that expired on the way, in
+    // expiry order. fire may move a one shot payload out, the node is freed afterwards; a periodic payload has to
+    // stay intact, its timer is added again one period later.
+    template <class F>
+    void Advance(uint64_t now_tick, F&& fire) {
+        while (this->current_ < now_tick) {
+            uint64_t next = this->NextTick();
+            if (next > now_tick) {
+                // no timer expires or moves down before now_tick
+                this->current_ = now_tick;
+                return;
+            }
+            this->current_ = next;
+            for (int level = 1; level < kLevelNum; ++level) {
+                if ((next >> (kSlotBits * (level - 1))) & (kSlotNum - 1)) {
+                    break;
+                }
+                this->Cascade(level, (next >> (kSlotBits * level)) & (kSlotNum - 1));
+            }
+            this->Expire(next & (kSlotNum - 1), fire);
+        }
+    }
+
+private:
+    static const uint32_t kNil = std::numeric_limits<uint32_t>::max();
+    static const uint32_t kChunkBits = 12;
+    static const uint32_t kChunkSize = uint32_t(1) << kChunkBits;
+
+    class Node {
+    public:
+        T payload_;
+        uint64_t expire_ = 0;
+        uint64_t period_ = 0;
+        uint32_t prev_ = kNil;
+        uint32_t next_ = kNil;
+        // bumped whenever the node is freed, so the ids of fired and cancelled timers go stale
+        uint32_t generation_ = 1;
+        uint8_t level_ = 0;
+        uint8_t slot_ = 0;
+        bool linked_ = false;
+    };
+
+    static uint64_t MakeId(uint32_t generation, uint32_t index) { return (uint64_t(generation) << 32) | index; }
+
+    Node& NodeAt(uint32_t index) { return this->chunks_[index >> kChunkBits][index & (kChunkSize - 1)]; }
+
+    uint32_t AllocNode() {
+        if (this->free_ == kNil) {
+            this->chunks_.emplace_back(new Node[kChunkSize]);
+            // the new nodes go to the free list in index order
+            for (uint32_t i = kChunkSize; i > 0; --i) {
+                uint32_t index = this->capacity_ + i - 1;
+                this->NodeAt(index).next_ = this->free_;
+                this->free_ = index;
+            }
+            this->capacity_ += kChunkSize;
+        }
+        uint32_t index = this->free_;
+        this->free_ = this->NodeAt(index).next_;
+        return index;
+    }
+
+    void FreeNode(uint32_t index) {
+        Node& node = this->NodeAt(index);
+        node.payload_ = T();
+        ++node.generation_;
+        if (node.generation_ == 0) {
+            node.generation_ = 1;
+        }
+        node.next_ = this->free_;
+        this->free_ = index;
+    }
+
+    // puts the node into the slot its expiry falls into as seen from the current tick
+    void Link(uint32_t index) {
+        Node& node = this->NodeAt(index);
+        uint64_t delta = node.expire_ - this->current_;
+        uint64_t expire = node.expire_;
+        int level = 0;
+        while (level < kLevelNum - 1 && delta >= (uint64_t(1) << (kSlotBits * (level + 1)))) {
+            ++level;
+        }
+        if (delta >= (uint64_t(1) << (kSlotBits * kLevelNum))) {
+            // beyond the range of the wheels: park it in the top level, it is placed again when that slot cascades
+            expire = this->current_ + (uint64_t(1) << (kSlotBits * kLevelNum)) - 1;
+        }
+        uint64_t slot = (expire >> (kSlotBits * level)) & (kSlotNum - 1);
+        uint32_t& head = this->slots_[level][slot];
+        node.level_ = static_cast<uint8_t>(level);
+        node.slot_ = static_cast<uint8_t>(slot);
+        node.prev_ = kNil;
+        node.next_ = head;
+        if (head != kNil) {
+            this->NodeAt(head).prev_ = index;
+        }
+        head = index;
+        node.linked_ = true;
+        this->occupied_[level] |= uint64_t(1) << slot;
+    }
+
+    void Unlink(uint32_t index) {
+        Node& node = this->NodeAt(index);
+        uint32_t& head = this->slots_[node.level_][node.slot_];
+        if (node.prev_ != kNil) {
+            this->NodeAt(node.prev_).next_ = node.next_;
+        } else {
+            head = node.next_;
+        }
+        if (node.next_ != kNil) {
+            this->NodeAt(node.next_).prev_ = node.prev_;
+        }
+        if (head == kNil) {
+            this->occupied_[node.level_] &= ~(uint64_t(1) << node.slot_);
+        }
+        node.linked_ = false;
+    }
+
+    // takes the whole list of a slot out, returns its first node
+    uint32_t TakeSlot(int level, uint64_t slot) {
+        uint32_t index = this->slots_[level][slot];
+        this->slots_[level][slot] = kNil;
+        this->occupied_[level] &= ~(uint64_t(1) << slot);
+        return index;
+    }
+
+    void Cascade(int level, uint64_t slot) {
+        uint32_t index = this->TakeSlot(level, slot);
+        while (index != kNil) {
+            uint32_t next = this->NodeAt(index).next_;
+            this->Link(index);
+            index = next;
+        }
+    }
+
+    template <class F>
+    void Expire(uint64_t slot, F& fire) {
+        uint32_t index = this->TakeSlot(0, slot);
+        while (index != kNil) {
+            Node& node = this->NodeAt(index);
+            uint32_t next = node.next_;
+            node.linked_ = false;
+            if (node.period_ > 0) {
+                fire(node.payload_, true);
+                node.expire_ = this->current_ + node.period_;
+                this->Link(index);
+            } else {
+                fire(node.payload_, false);
+                this->FreeNode(index);
+                --this->size_;
+            }
+            index = next;
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<Node[]>> chunks_;
+    uint32_t capacity_ = 0;
+    uint32_t free_ = kNil;
+    uint32_t slots_[kLevelNum][kSlotNum];
+    uint64_t occupied_[kLevelNum] = {0, 0, 0, 0};
+    uint64_t current_ = 0;
+    size_t size_ = 0;
+};
+
+template <typename T>
+const uint64_t TimingWheel<T>::kSlotNum;
+template <typename T>
+const uint64_t TimingWheel<T>::kInvalidId;
+template <typename T>
+const uint32_t TimingWheel<T>::kNil;
+
+}  // namespace med
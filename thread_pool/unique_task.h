@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace med {
+
+// A move-only `void()` callable. Callables up to kInlineSize bytes are stored inside the object, larger ones on
+// the heap. Unlike std::function it accepts move-only callables such as a lambda owning a std::promise.
+class UniqueTask {
+public:
+    static const size_t kInlineSize = 56;
+
+    UniqueTask() noexcept = default;
+    UniqueTask(std::nullptr_t) noexcept {}
+
+    template <typename F, typename Fn = typename std::decay<F>::type,
+              typename = typename std::enable_if<!std::is_same<Fn, UniqueTask>::value>::type>
+    UniqueTask(F&& f) {
+        this->Construct<Fn>(std::forward<F>(f), std::integral_constant<bool, IsInline<Fn>()>());
+    }
+
+    UniqueTask(UniqueTask&& other) noexcept { this->MoveFrom(other); }
+
+    UniqueTask& operator=(UniqueTask&& other) noexcept {
+        if (this != &other) {
+            this->Destroy();
+            this->MoveFrom(other);
+        }
+        return *this;
+    }
+
+    UniqueTask& operator=(std::nullptr_t) noexcept {
+        this->Destroy();
+        return *this;
+    }
+
+    UniqueTask(const UniqueTask&) = delete;
+    UniqueTask& operator=(const UniqueTask&) = delete;
+
+    ~UniqueTask() { this->Destroy(); }
+
+    void operator()() { this->ops_->invoke(&this->storage_); }
+
+    explicit operator bool() const noexcept { return this->ops_ != nullptr; }
+    bool operator==(std::nullptr_t) const noexcept { return this->ops_ == nullptr; }
+    bool operator!=(std::nullptr_t) const noexcept { return this->ops_ != nullptr; }
+
+    template <typename F>
+    static constexpr bool IsInline() {
+        return sizeof(F) <= kInlineSize && alignof(F) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<F>::value;
+    }
+
+private:
+    using Storage = typename std::aligned_storage<kInlineSize, alignof(std::max_align_t)>::type;
+
+    struct Ops {
+        void (*invoke)(void* storage);
+        // move constructs into dst and destroys src
+        void (*relocate)(void* dst, void* src) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template <typename F>
+    struct InlineOps {
+        static void Invoke(void* storage) { (*static_cast<F*>(storage))(); }
+        static void Relocate(void* dst, void* src) noexcept {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+        static void Destroy(void* storage) noexcept { static_cast<F*>(storage)->~F(); }
+        static const Ops* Get() {
+            static const Ops ops{&Invoke, &Relocate, &Destroy};
+            return &ops;
+        }
+    };
+
+    template <typename F>
+    struct HeapOps {
+        static F*& Ptr(void* storage) { return *static_cast<F**>(storage); }
+        static void Invoke(void* storage) { (*Ptr(storage))(); }
+        static void Relocate(void* dst, void* src) noexcept { new (dst) F*(Ptr(src)); }
+        static void Destroy(void* storage) noexcept { delete Ptr(storage); }
+        static const Ops* Get() {
+            static const Ops ops{&Invoke, &Relocate, &Destroy};
+            return &ops;
+        }
+    };
+
+    template <typename Fn, typename F>
+    void Construct(F&& f, std::true_type) {
+        new (&this->storage_) Fn(std::forward<F>(f));
+        this->ops_ = InlineOps<Fn>::Get();
+    }
+
+    template <typename Fn, typename F>
+    void Construct(F&& f, std::false_type) {
+        new (&this->storage_) Fn*(new Fn(std::forward<F>(f)));
+        this->ops_ = HeapOps<Fn>::Get();
+    }
+
+    void MoveFrom(UniqueTask& other) noexcept {
+        if (other.ops_ != nullptr) {
+            other.ops_->relocate(&this->storage_, &other.storage_);
+            this->ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    void Destroy() noexcept {
+        if (this->ops_ != nullptr) {
+            this->ops_->destroy(&this->storage_);
+            this->ops_ = nullptr;
+        }
+    }
+
+private:
+    Storage storage_;
+    const Ops* ops_ = nullptr;
+};
+
+}  // namespace med
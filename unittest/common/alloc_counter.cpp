@@ -0,0 +1,34 @@
+#include "unittest/common/alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<size_t> g_alloc_count{0};
+}  // namespace
+
+namespace med_test {
+
+size_t AllocCount() { return g_alloc_count.load(); }
+
+}  // namespace med_test
+
+void* operator new(size_t size) {
+    ++g_alloc_count;
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) { return ::operator new(size); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+
+namespace med_test {
+
+// number of global operator new calls made by the whole process so far
+size_t AllocCount();
+
+}  // namespace med_test
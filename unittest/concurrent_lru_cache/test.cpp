@@ -1,8 +1,10 @@
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <thread>
 
 #include "concurrent_lru_cache/concurrent_lru_cache.h"
+#include "unittest/common/alloc_counter.h"
 
 #include <gtest/gtest.h>
 
@@ -268,4 +270,309 @@ TEST(ConcurrentLRUCache, Basic) {
     cache.MGet(keys.begin(), keys.end(), kv_map);
 
     EXPECT_EQ(kv_map.size(), 0);
-}
\ No newline at end of file
+}
+
+TEST(ClockCache, Basic) {
+    med::ClockCache<std::string, int> cache(4);
+    int v;
+    for (int i = 0; i < 4; ++i) {
+        cache.Set(std::to_string(i), i);
+    }
+    // 1 and 3 get their second chance, 0 and 2 go
+    EXPECT_TRUE(cache.Get("1", v));
+    EXPECT_TRUE(cache.Get("3", v));
+    cache.Set("4", 4);
+    cache.Set("5", 5);
+    EXPECT_FALSE(cache.Get("0", v));
+    EXPECT_FALSE(cache.Get("2", v));
+    EXPECT_TRUE(cache.Get("1", v));
+    EXPECT_EQ(v, 1);
+    EXPECT_TRUE(cache.Get("3", v));
+    EXPECT_TRUE(cache.Get("4", v));
+    EXPECT_TRUE(cache.Get("5", v));
+
+    // updating an entry keeps it
+    cache.Set("4", 40);
+    EXPECT_TRUE(cache.Get("4", v));
+    EXPECT_EQ(v, 40);
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < 10; ++i) {
+        keys.push_back(std::to_string(i));
+    }
+    std::unordered_map<std::string, int> kv_map;
+    cache.MGet(keys.begin(), keys.end(), kv_map);
+    EXPECT_EQ(kv_map.size(), 4);
+
+    med::ClockCache<std::string, int> empty(0);
+    empty.Set("0", 0);
+    EXPECT_FALSE(empty.Get("0", v));
+}
+
+TEST(ClockCache, TTL) {
+    med::ClockCache<std::string, int, true> cache(2, 1);
+    int v;
+    cache.Set("0", 0);
+    cache.Set("1", 1);
+    EXPECT_TRUE(cache.Get("0", v));
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    EXPECT_FALSE(cache.Get("0", v));
+    // expired entries are evicted first, referenced or not
+    cache.Set("2", 2);
+    cache.Set("3", 3);
+    EXPECT_TRUE(cache.Get("2", v));
+    EXPECT_TRUE(cache.Get("3", v));
+}
+
+TEST(ConcurrentLRUCache, Clock) {
+    med::ConcurrentLRUCache<int, std::string, false, std::hash<int>, med::EvictionPolicy::kClock> cache(1000, 4);
+    for (int i = 0; i < 1000; ++i) {
+        cache.Set(i, std::to_string(i));
+    }
+    std::atomic<int> hits{0};
+    std::atomic<bool> mismatch{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            std::string v;
+            for (int i = 0; i < 20000; ++i) {
+                int key = (i * 7 + t) % 2000;
+                if (i % 10 == t) {
+                    cache.Set(key, std::to_string(key));
+                } else if (cache.Get(key, v)) {
+                    ++hits;
+                    if (v != std::to_string(key)) {
+                        mismatch = true;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_FALSE(mismatch.load());
+    EXPECT_GT(hits.load(), 0);
+}
+
+TEST(FlatLRUCache, Basic) {
+    med::FlatLRUCache<std::string, int> cache(5);
+    int v;
+    for (int idx = 0; idx < 5; ++idx) {
+        cache.Set(std::to_string(idx), idx);
+    }
+    for (int idx = 0; idx < 5; ++idx) {
+        EXPECT_TRUE(cache.Get(std::to_string(idx), v));
+        EXPECT_EQ(v, idx);
+    }
+    EXPECT_FALSE(cache.Get("not exist", v));
+
+    cache.Set("5", 5);  // (1, 1) (2, 2) (3, 3) (4, 4) (5, 5)
+    EXPECT_FALSE(cache.Get("0", v));
+    cache.Set("6", 6);               // (2, 2) (3, 3) (4, 4) (5, 5) (6, 6)
+    EXPECT_TRUE(cache.Get("2", v));  // (3, 3) (4, 4) (5, 5) (6, 6) (2, 2)
+    cache.Set("7", 7);               // (4, 4) (5, 5) (6, 6) (2, 2) (7, 7)
+    EXPECT_FALSE(cache.Get("1", v));
+    EXPECT_TRUE(cache.Get("2", v));  // (4, 4) (5, 5) (6, 6) (7, 7) (2, 2)
+    cache.Set("4", 40);              // (5, 5) (6, 6) (7, 7) (2, 2) (4, 40)
+
+    // (4, 40) (8, 8) (9, 9) (10, 10) (11, 11)
+    for (int i = 8; i < 12; ++i) {
+        cache.Set(std::to_string(i), i);
+    }
+    std::vector<std::string> keys;
+    for (int i = 0; i < 15; ++i) {
+        keys.push_back(std::to_string(i));
+    }
+    std::unordered_map<std::string, int> kv_map;
+    cache.MGet(keys.begin(), keys.end(), kv_map);
+    EXPECT_EQ(kv_map.size(), 5);
+    EXPECT_EQ(kv_map["4"], 40);
+    EXPECT_EQ(kv_map["8"], 8);
+    EXPECT_EQ(kv_map["11"], 11);
+
+    med::FlatLRUCache<std::string, int> empty(0);
+    empty.Set("0", 0);
+    EXPECT_FALSE(empty.Get("0", v));
+}
+
+TEST(FlatLRUCache, TTL) {
+    med::FlatLRUCache<std::string, int, true> cache(3, 1);
+    int v;
+    cache.Set("0", 0);
+    cache.Set("1", 1);
+    EXPECT_TRUE(cache.Get("0", v));
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    EXPECT_FALSE(cache.Get("0", v));
+    cache.Set("2", 2);
+    cache.Set("3", 3);
+    // "0" freed its slot on expiry, so "1" is the one evicted for "4"
+    cache.Set("4", 4);
+    EXPECT_FALSE(cache.Get("1", v));
+    EXPECT_TRUE(cache.Get("2", v));
+    EXPECT_TRUE(cache.Get("3", v));
+    EXPECT_TRUE(cache.Get("4", v));
+}
+
+TEST(FlatLRUCache, SameAsLRUCache) {
+    // colliding keys exercise probing and the back shift on erase
+    med::LRUCache<int, int> lru(200);
+    med::FlatLRUCache<int, int> flat(200);
+    uint32_t state = 1;
+    for (int i = 0; i < 100000; ++i) {
+        state = state * 1103515245 + 12345;
+        int key = static_cast<int>((state >> 16) % 512) * 1024;
+        int expected = 0;
+        int v = 0;
+        if (state % 3 == 0) {
+            lru.Set(key, i);
+            flat.Set(key, i);
+        } else {
+            bool found = lru.Get(key, expected);
+            ASSERT_EQ(flat.Get(key, v), found);
+            if (found) {
+                ASSERT_EQ(v, expected);
+            }
+        }
+    }
+}
+
+TEST(FlatLRUCache, NoAllocation) {
+    med::FlatLRUCache<int, int> cache(1000);
+    size_t allocs = med_test::AllocCount();
+    int v = 0;
+    for (int i = 0; i < 5000; ++i) {
+        cache.Set(i, i);
+        cache.Get(i / 2, v);
+    }
+    EXPECT_EQ(med_test::AllocCount(), allocs);
+    EXPECT_TRUE(cache.Get(4999, v));
+    EXPECT_FALSE(cache.Get(3999, v));
+}
+
+TEST(ConcurrentLRUCache, FlatLRU) {
+    med::ConcurrentLRUCache<int, int, false, std::hash<int>, med::EvictionPolicy::kFlatLRU> cache(1000, 4);
+    for (int i = 0; i < 1000; ++i) {
+        cache.Set(i, i);
+    }
+    int v;
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(cache.Get(i, v));
+        EXPECT_EQ(v, i);
+    }
+    cache.Set(1000, 1000);
+    EXPECT_TRUE(cache.Get(1000, v));
+}
+
+TEST(FrequencySketch, Basic) {
+    med::FrequencySketch<int> sketch(64);
+    EXPECT_EQ(sketch.Frequency(1), 0);
+    for (int i = 0; i < 5; ++i) {
+        sketch.Increment(1);
+    }
+    EXPECT_EQ(sketch.Frequency(1), 5);
+    // counters saturate at 15
+    for (int i = 0; i < 20; ++i) {
+        sketch.Increment(2);
+    }
+    EXPECT_EQ(sketch.Frequency(2), 15);
+
+    // 10 increments per entry halve every count
+    for (int i = 0; i < 640 - 25 + 15; ++i) {
+        sketch.Increment(1000 + i);
+    }
+    EXPECT_LE(sketch.Frequency(2), 8);
+    EXPECT_GE(sketch.Frequency(2), 7);
+    EXPECT_LE(sketch.Frequency(1), 3);
+}
+
+TEST(TinyLFUCache, Basic) {
+    med::TinyLFUCache<std::string, int> cache(200);
+    int v;
+    for (int i = 0; i < 200; ++i) {
+        cache.Set(std::to_string(i), i);
+    }
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_TRUE(cache.Get(std::to_string(i), v));
+        EXPECT_EQ(v, i);
+    }
+    cache.Set("7", 70);
+    EXPECT_TRUE(cache.Get("7", v));
+    EXPECT_EQ(v, 70);
+
+    // never more than the capacity
+    for (int i = 200; i < 1000; ++i) {
+        cache.Set(std::to_string(i), i);
+    }
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(std::to_string(i));
+    }
+    std::unordered_map<std::string, int> kv_map;
+    cache.MGet(keys.begin(), keys.end(), kv_map);
+    EXPECT_LE(kv_map.size(), 200);
+    EXPECT_GT(kv_map.size(), 0);
+
+    med::TinyLFUCache<std::string, int> one(1);
+    one.Set("0", 0);
+    EXPECT_TRUE(one.Get("0", v));
+    one.Set("1", 1);
+    EXPECT_TRUE(one.Get("1", v));
+    EXPECT_FALSE(one.Get("0", v));
+
+    med::TinyLFUCache<std::string, int> empty(0);
+    empty.Set("0", 0);
+    EXPECT_FALSE(empty.Get("0", v));
+}
+
+TEST(TinyLFUCache, ScanResistance) {
+    // 50 hot keys with a scan of twice the capacity in between every pass over them, which leaves an LRU nothing
+    med::TinyLFUCache<int, int> cache(100);
+    int v;
+    int scan_key = 1000;
+    int hits = 0;
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 50; ++i) {
+            if (cache.Get(i, v)) {
+                hits += round >= 5;
+            } else {
+                cache.Set(i, i);
+            }
+        }
+        for (int i = 0; i < 200; ++i, ++scan_key) {
+            if (!cache.Get(scan_key, v)) {
+                cache.Set(scan_key, scan_key);
+            }
+        }
+    }
+    EXPECT_EQ(hits, 5 * 50);
+}
+
+TEST(TinyLFUCache, TTL) {
+    med::TinyLFUCache<std::string, int, true> cache(10, 1);
+    int v;
+    cache.Set("0", 0);
+    cache.Set("1", 1);
+    EXPECT_TRUE(cache.Get("0", v));
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    EXPECT_FALSE(cache.Get("0", v));
+    EXPECT_FALSE(cache.Get("1", v));
+    cache.Set("2", 2);
+    EXPECT_TRUE(cache.Get("2", v));
+}
+
+TEST(ConcurrentLRUCache, TinyLFU) {
+    med::ConcurrentLRUCache<int, int, false, std::hash<int>, med::EvictionPolicy::kTinyLFU> cache(1000, 4);
+    for (int i = 0; i < 1000; ++i) {
+        cache.Set(i, i);
+    }
+    int v;
+    int hits = 0;
+    for (int i = 0; i < 1000; ++i) {
+        if (cache.Get(i, v)) {
+            ++hits;
+            EXPECT_EQ(v, i);
+        }
+    }
+    EXPECT_GT(hits, 900);
+}
@@ -1,6 +1,19 @@
 #include <gtest/gtest.h>
+#include "mem_pool/arena_string.h"
+#include "mem_pool/arena_vector.h"
+#include "mem_pool/block_source.h"
+#include "mem_pool/concurrent_mem_pool.h"
 #include "mem_pool/mem_pool.h"
+#include "mem_pool/pool_allocator.h"
+#include "mem_pool/size_class_mem_pool.h"
+#include "unittest/common/alloc_counter.h"
 
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace {
@@ -10,6 +23,46 @@ public:
     int x_ = 0;
     int y_ = 0;
 };
+
+struct alignas(64) CacheLine {
+    explicit CacheLine(int v = 0) : value(v) {}
+    int value;
+};
+
+class Tracked {
+public:
+    Tracked(int* destroyed, std::unique_ptr<int> value) : destroyed_(destroyed), value_(std::move(value)) {}
+    // throws once budget constructions used it up
+    Tracked(int* destroyed, int* budget) : destroyed_(destroyed) {
+        if (*budget == 0) {
+            throw std::runtime_error("construction failed");
+        }
+        --*budget;
+    }
+    ~Tracked() { ++*this->destroyed_; }
+    int* destroyed_;
+    std::unique_ptr<int> value_;
+};
+
+// counts what goes to malloc
+class CountingSource : public med::BlockSource {
+public:
+    void* Allocate(size_t size) override {
+        ++this->allocs_;
+        return med::MallocBlockSource::Instance()->Allocate(size);
+    }
+    void Deallocate(void* ptr, size_t size) override {
+        ++this->frees_;
+        med::MallocBlockSource::Instance()->Deallocate(ptr, size);
+    }
+    int allocs_ = 0;
+    int frees_ = 0;
+};
+
+template <typename T>
+bool IsAligned(const T* ptr, size_t align) {
+    return reinterpret_cast<uintptr_t>(ptr) % align == 0;
+}
 }  // namespace
 
 TEST(MemPool, Basic) {
@@ -33,7 +86,9 @@ TEST(MemPool, Basic) {
     EXPECT_EQ(p->x_, 3);
     EXPECT_EQ(p->y_, 4);
 
-    EXPECT_EQ(pool.Used(), sizeof(int) * (1 + 1 + 10 + 20) + sizeof(std::string) + sizeof(Point));
+    // only the string needs a destructor record, Point is trivially destructible
+    EXPECT_EQ(pool.Used(), sizeof(int) * (1 + 1 + 10 + 20) + sizeof(std::string) + sizeof(Point) +
+                               sizeof(med::internal::DestructorRecord));
     EXPECT_EQ(pool.AllocatedSize(), 1024);
 }
 
@@ -112,4 +167,505 @@ TEST(MemPool, ScaleUp) {
             EXPECT_EQ(pool.AllocatedSize(), 200);
         }
     }
-}
\ No newline at end of file
+}
+
+TEST(MemPool, Alignment) {
+    med::MemPool pool(256, 1024, 0);
+    char* c = pool.Create<char>('a');
+    double* d = pool.Create<double>(1.5);
+    EXPECT_TRUE(IsAligned(d, alignof(double)));
+    EXPECT_EQ(*c, 'a');
+    EXPECT_EQ(*d, 1.5);
+
+    pool.Create<char>('b');
+    CacheLine* line = pool.Create<CacheLine>(7);
+    EXPECT_TRUE(IsAligned(line, 64));
+    EXPECT_EQ(line->value, 7);
+    CacheLine* lines = pool.CreateArray<CacheLine>(3, 9);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(IsAligned(lines + i, 64));
+        EXPECT_EQ(lines[i].value, 9);
+    }
+
+    // raw allocations, also when they need a new block or one larger than max_block_size
+    for (size_t align : {size_t(1), size_t(8), size_t(32), size_t(64), size_t(4096)}) {
+        pool.Alloc(3);
+        char* raw = pool.AllocAligned(200, align);
+        EXPECT_TRUE(IsAligned(raw, align));
+        char* large = pool.AllocAligned(2000, align);
+        EXPECT_TRUE(IsAligned(large, align));
+    }
+
+    // the padding in front of an aligned object counts as used
+    med::MemPool fresh(256, 1024, 0);
+    fresh.Alloc(1);
+    fresh.AllocAligned(8, 64);
+    EXPECT_GE(fresh.Used(), 9);
+    EXPECT_LE(fresh.Used(), 72);
+}
+
+TEST(MemPool, Destructors) {
+    int destroyed = 0;
+    {
+        med::MemPool pool(1024);
+        // move only arguments are forwarded
+        Tracked* t = pool.Create<Tracked>(&destroyed, std::unique_ptr<int>(new int(5)));
+        EXPECT_EQ(*t->value_, 5);
+        int budget = 100;
+        pool.CreateArray<Tracked>(3, &destroyed, &budget);
+        pool.Reset();
+        EXPECT_EQ(destroyed, 4);
+
+        // the elements constructed before a throwing one are destroyed right away, nothing is left to Reset()
+        destroyed = 0;
+        budget = 2;
+        EXPECT_THROW(pool.CreateArray<Tracked>(5, &destroyed, &budget), std::runtime_error);
+        EXPECT_EQ(destroyed, 2);
+        pool.Reset();
+        EXPECT_EQ(destroyed, 2);
+        destroyed = 0;
+
+        pool.Create<Tracked>(&destroyed, std::unique_ptr<int>());
+    }
+    // and by the destructor of the pool
+    EXPECT_EQ(destroyed, 1);
+
+    // no allocation per object once the blocks are big enough
+    med::MemPool pool(256, 64 * 1024, 0);
+    int budget = 1000;
+    for (int round = 0; round < 3; ++round) {
+        size_t allocs = med_test::AllocCount();
+        for (int i = 0; i < 100; ++i) {
+            pool.Create<Tracked>(&destroyed, std::unique_ptr<int>());
+            pool.Create<std::string>("short");
+            pool.Create<Point>(i, i);
+            pool.CreateArray<Tracked>(2, &destroyed, &budget);
+        }
+        if (round > 0) {
+            EXPECT_EQ(med_test::AllocCount(), allocs);
+        }
+        pool.Reset(true);
+    }
+}
+
+TEST(MemPool, SizeClass) {
+    const size_t class_num = med::SizeClassMemPool::kClassNum;
+    for (size_t size = 1; size <= med::SizeClassMemPool::kMaxClassSize; ++size) {
+        size_t cls = med::SizeClassMemPool::ClassOf(size);
+        ASSERT_LT(cls, class_num);
+        ASSERT_GE(med::SizeClassMemPool::ClassSize(cls), size);
+        if (cls > 0) {
+            ASSERT_LT(med::SizeClassMemPool::ClassSize(cls - 1), size);
+        }
+    }
+
+    med::SizeClassMemPool pool(1024, 4096);
+    Point* p = pool.Create<Point>(3, 4);
+    EXPECT_EQ(p->x_, 3);
+    EXPECT_EQ(pool.Used(), 16);
+    pool.Destroy(p);
+    EXPECT_EQ(pool.Used(), 0);
+    EXPECT_EQ(pool.FreeChunks(sizeof(Point)), 1);
+
+    // the freed chunk is reused by the next request of its class
+    Point* q = pool.Create<Point>(5, 6);
+    EXPECT_EQ(static_cast<void*>(q), static_cast<void*>(p));
+    EXPECT_EQ(pool.FreeChunks(sizeof(Point)), 0);
+
+    std::string* s = pool.Create<std::string>(100, 'x');
+    void* raw = pool.Alloc(1500);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(raw) % 16, 0);
+    void* big = pool.Alloc(1 << 20);
+    EXPECT_EQ(pool.Used(), 16 + 32 + 1536 + (1 << 20));
+    pool.Free(big, 1 << 20);
+    pool.Free(raw, 1500);
+    EXPECT_EQ(pool.Alloc(1400), raw);
+    pool.Free(raw, 1400);
+    pool.Destroy(s);
+    pool.Destroy(q);
+    EXPECT_EQ(pool.Used(), 0);
+
+    // churn stays within the memory of the peak live set
+    std::vector<void*> live;
+    for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 50; ++i) {
+            live.push_back(pool.Alloc(24 + i));
+        }
+        for (int i = 0; i < 50; ++i) {
+            pool.Free(live[i], 24 + i);
+        }
+        live.clear();
+    }
+    size_t allocated = pool.AllocatedSize();
+    EXPECT_LT(allocated, 16 * 1024);
+    pool.Reset();
+    EXPECT_EQ(pool.Used(), 0);
+}
+
+TEST(MemPool, PoolAllocator) {
+    using String = std::basic_string<char, std::char_traits<char>, med::PoolAllocator<char>>;
+    using Map = std::unordered_map<int, String, std::hash<int>, std::equal_to<int>,
+                                   med::PoolAllocator<std::pair<const int, String>>>;
+    med::MemPool pool(64 * 1024, 1024 * 1024, 0);
+    med::PoolAllocator<int> alloc(pool);
+    EXPECT_TRUE(alloc == med::PoolAllocator<double>(pool));
+    med::MemPool other;
+    EXPECT_TRUE(alloc != med::PoolAllocator<int>(other));
+
+    size_t allocs = med_test::AllocCount();
+    {
+        std::vector<int, med::PoolAllocator<int>> ids(alloc);
+        for (int i = 0; i < 1000; ++i) {
+            ids.push_back(i);
+        }
+        Map names(16, std::hash<int>(), std::equal_to<int>(), Map::allocator_type(pool));
+        for (int i = 0; i < 100; ++i) {
+            names.emplace(i, String("a name too long for the small string buffer", String::allocator_type(pool)));
+        }
+        EXPECT_EQ(ids[999], 999);
+        EXPECT_EQ(names.at(42).size(), 43);
+        EXPECT_EQ(names.at(42).get_allocator(), String::allocator_type(pool));
+    }
+    EXPECT_EQ(med_test::AllocCount(), allocs);
+    EXPECT_GT(pool.Used(), 1000 * sizeof(int));
+    pool.Reset();
+    EXPECT_EQ(pool.Used(), 0);
+
+    // with a SizeClassMemPool the memory goes back to the free lists right away
+    med::SizeClassMemPool size_class;
+    {
+        std::vector<int, med::PoolAllocator<int, med::SizeClassMemPool>> ids(
+            (med::PoolAllocator<int, med::SizeClassMemPool>(size_class)));
+        for (int i = 0; i < 1000; ++i) {
+            ids.push_back(i);
+        }
+        EXPECT_EQ(size_class.Used(), med::SizeClassMemPool::ClassSize(med::SizeClassMemPool::ClassOf(
+                                         ids.capacity() * sizeof(int))));
+    }
+    EXPECT_EQ(size_class.Used(), 0);
+}
+
+TEST(MemPool, Concurrent) {
+    const int thread_num = 4;
+    const int object_num = 10000;
+    struct Counted {
+        explicit Counted(std::atomic<int>* destroyed) : destroyed_(destroyed) {}
+        ~Counted() { ++*this->destroyed_; }
+        std::atomic<int>* destroyed_;
+    };
+
+    med::ConcurrentMemPool pool(4096);
+    std::atomic<int> destroyed{0};
+    std::vector<std::vector<int*>> values(thread_num);
+    size_t allocated = 0;
+    for (int round = 0; round < 2; ++round) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < thread_num; ++t) {
+            threads.emplace_back([&, t] {
+                values[t].clear();
+                for (int i = 0; i < object_num; ++i) {
+                    values[t].push_back(pool.Create<int>(t * object_num + i));
+                    if (i % 100 == 0) {
+                        pool.Create<Counted>(&destroyed);
+                        pool.Alloc(3000);
+                        EXPECT_EQ(reinterpret_cast<uintptr_t>(pool.AllocAligned(16, 64)) % 64, 0);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        // nothing was handed out twice
+        for (int t = 0; t < thread_num; ++t) {
+            for (int i = 0; i < object_num; ++i) {
+                ASSERT_EQ(*values[t][i], t * object_num + i);
+            }
+        }
+        // a thread may get the cache of an exited one with the same id
+        EXPECT_GE(pool.ThreadNum(), thread_num);
+        EXPECT_LE(pool.ThreadNum(), (round + 1) * thread_num);
+        EXPECT_EQ(pool.Used(), thread_num * (object_num * sizeof(int) + object_num / 100 *
+                                             (sizeof(Counted) + sizeof(med::internal::DestructorRecord) + 3000 + 16)));
+        EXPECT_GE(pool.AllocatedSize(), pool.Used());
+        pool.Reset();
+        EXPECT_EQ(destroyed.load(), thread_num * object_num / 100);
+        EXPECT_EQ(pool.Used(), 0);
+        destroyed = 0;
+        if (round == 0) {
+            allocated = pool.AllocatedSize();
+        } else {
+            // the second round got by with the blocks of the first
+            EXPECT_EQ(pool.AllocatedSize(), allocated);
+        }
+    }
+}
+
+TEST(MemPool, BlockSource) {
+    CountingSource upstream;
+    {
+        med::CachedBlockSource cache(1024 * 1024, &upstream);
+        for (int request = 0; request < 10; ++request) {
+            // a fresh pool per request, growing to a few blocks
+            med::MemPool pool(1024, 8 * 1024, 0, &cache);
+            for (int i = 0; i < 50; ++i) {
+                pool.CreateArray<char>(100);
+            }
+            pool.Reset();
+            for (int i = 0; i < 50; ++i) {
+                pool.CreateArray<char>(100);
+            }
+        }
+        // the first request took its blocks from the upstream, the rest recycled them
+        int warm = upstream.allocs_;
+        EXPECT_GT(cache.Hits(), 0);
+        EXPECT_EQ(cache.Misses(), warm);
+        EXPECT_EQ(upstream.frees_, 0);
+        EXPECT_GT(cache.CachedBytes(), 0);
+
+        // nothing past max_cached_bytes is kept
+        med::CachedBlockSource small(1000, &upstream);
+        small.Deallocate(small.Allocate(600), 600);
+        small.Deallocate(small.Allocate(600), 600);
+        void* a = small.Allocate(600);
+        void* b = small.Allocate(600);
+        small.Deallocate(a, 600);
+        small.Deallocate(b, 600);
+        EXPECT_EQ(small.CachedBytes(), 600);
+    }
+    EXPECT_EQ(upstream.allocs_, upstream.frees_);
+
+#if defined(__unix__) || defined(__APPLE__)
+    med::MmapBlockSource mmap_source(16 * 1024 * 1024);
+    med::MemPool pool(4096, 1024 * 1024, 0, &mmap_source);
+    char* small_data = pool.CreateArray<char>(100, 'a');
+    // above max_block_size, gets a 2 MB aligned block of its own
+    char* huge = pool.CreateArray<char>(3 * 1024 * 1024, 'b');
+    EXPECT_EQ(small_data[99], 'a');
+    EXPECT_EQ(huge[3 * 1024 * 1024 - 1], 'b');
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(huge) % (2 * 1024 * 1024), 0);
+    pool.Reset();
+    EXPECT_EQ(mmap_source.CachedBytes(), 4 * 1024 * 1024);
+    // the mapping is reused, its pages were dropped and read as zero again
+    char* again = pool.CreateArray<char>(3 * 1024 * 1024);
+    EXPECT_EQ(again, huge);
+    EXPECT_EQ(mmap_source.CachedBytes(), 0);
+    void* raw = mmap_source.Allocate(1);
+    static_cast<char*>(raw)[0] = 1;
+    mmap_source.Deallocate(raw, 1);
+    EXPECT_EQ(static_cast<char*>(mmap_source.Allocate(1))[0], 0);
+    mmap_source.Deallocate(raw, 1);
+#endif
+}
+
+TEST(MemPool, Rollback) {
+    int destroyed = 0;
+    int budget = 1000;
+    med::MemPool pool(1024, 4096, 0);
+    pool.Create<Tracked>(&destroyed, &budget);
+    size_t used = pool.Used();
+    size_t allocated = pool.AllocatedSize();
+    med::MemPoolMark mark = pool.Mark();
+
+    char* scratch = pool.CreateArray<char>(100);
+    for (int i = 0; i < 20; ++i) {
+        pool.Create<Tracked>(&destroyed, &budget);
+        pool.CreateArray<char>(500);
+    }
+    EXPECT_GT(pool.AllocatedSize(), allocated);
+    pool.Rollback(mark);
+    EXPECT_EQ(destroyed, 20);
+    EXPECT_EQ(pool.Used(), used);
+    EXPECT_EQ(pool.AllocatedSize(), allocated);
+    // the same memory again
+    EXPECT_EQ(pool.CreateArray<char>(100), scratch);
+    pool.Rollback(mark);
+
+    // nested scopes, only the committed one keeps its objects
+    destroyed = 0;
+    {
+        med::MemPoolScope outer(pool);
+        pool.Create<Tracked>(&destroyed, &budget);
+        {
+            med::MemPoolScope inner(pool);
+            pool.Create<Tracked>(&destroyed, &budget);
+            pool.CreateArray<char>(3000);
+        }
+        EXPECT_EQ(destroyed, 1);
+        {
+            med::MemPoolScope inner(pool);
+            pool.Create<Tracked>(&destroyed, &budget);
+            inner.Commit();
+        }
+        EXPECT_EQ(destroyed, 1);
+    }
+    EXPECT_EQ(destroyed, 3);
+    EXPECT_EQ(pool.Used(), used);
+
+    // trying alternatives one after the other needs no more memory than the biggest of them
+    for (int round = 0; round < 100; ++round) {
+        med::MemPoolScope scope(pool);
+        pool.CreateArray<char>(200 + round);
+        pool.Create<std::string>(1000, 'x');
+    }
+    EXPECT_EQ(pool.AllocatedSize(), allocated);
+    pool.Reset();
+    EXPECT_EQ(destroyed, 4);
+}
+
+TEST(MemPool, ArenaVector) {
+    med::MemPool pool(64 * 1024, 1024 * 1024, 0);
+    size_t allocs = med_test::AllocCount();
+    {
+        med::ArenaVector<int> ints(pool);
+        ints.PushBack(0);
+        const int* first = ints.Data();
+        for (int i = 1; i < 1000; ++i) {
+            ints.PushBack(i);
+        }
+        // the latest allocation of the pool grows in place
+        EXPECT_EQ(ints.Data(), first);
+        EXPECT_EQ(ints.Size(), 1000);
+        EXPECT_GE(pool.Used(), 1000 * sizeof(int));
+        EXPECT_LT(pool.Used(), 2048 * sizeof(int));
+
+        // something else allocated after it, the next growth relocates inside the pool
+        ints.Reserve(ints.Size() + 1);
+        char* blocker = pool.CreateArray<char>(1);
+        int end = 1000 + static_cast<int>(ints.Capacity());
+        for (int i = 1000; i < end; ++i) {
+            ints.PushBack(i);
+        }
+        EXPECT_NE(ints.Data(), first);
+        EXPECT_GT(static_cast<const void*>(ints.Data()), static_cast<const void*>(blocker));
+        for (size_t i = 0; i < ints.Size(); ++i) {
+            ASSERT_EQ(ints[i], static_cast<int>(i));
+        }
+
+        med::Span<const int> view = ints.View().Sub(10, 5);
+        EXPECT_EQ(view.Size(), 5);
+        EXPECT_EQ(view[0], 10);
+        EXPECT_EQ(ints.View().Sub(ints.Size() - 2).Size(), 2);
+        EXPECT_TRUE(ints.View().Sub(ints.Size() + 10).Empty());
+
+        ints.Resize(3);
+        EXPECT_EQ(ints.Back(), 2);
+        ints.Resize(5, 7);
+        EXPECT_EQ(ints.Back(), 7);
+        EXPECT_EQ(med_test::AllocCount(), allocs);
+        EXPECT_THROW(ints.At(5), std::out_of_range);
+    }
+
+    // the strings own heap memory, the leak checker complains if an element is not destroyed
+    {
+        med::ArenaVector<std::string> names(pool);
+        for (int i = 0; i < 100; ++i) {
+            names.EmplaceBack(100, static_cast<char>('a' + i % 26));
+            pool.Alloc(1);
+        }
+        EXPECT_EQ(names[99], std::string(100, 'a' + 99 % 26));
+        med::ArenaVector<std::string> moved(std::move(names));
+        EXPECT_TRUE(names.Empty());
+        EXPECT_EQ(moved.Size(), 100);
+        names = std::move(moved);
+        EXPECT_EQ(names.Size(), 100);
+        names.Resize(10);
+    }
+}
+
+TEST(MemPool, ArenaString) {
+    med::MemPool pool(64 * 1024, 1024 * 1024, 0);
+    size_t allocs = med_test::AllocCount();
+    med::ArenaString empty(pool);
+    EXPECT_STREQ(empty.CStr(), "");
+    EXPECT_EQ(empty.Size(), 0);
+
+    med::ArenaString str(pool, "key");
+    str += '=';
+    str += "value";
+    str.Append(std::string(";"));
+    EXPECT_EQ(str, "key=value;");
+    EXPECT_STREQ(str.CStr(), "key=value;");
+    med::Span<const char> value = str.Sub(4, 5);
+    EXPECT_EQ(med::ArenaString(pool, value), "value");
+    EXPECT_EQ(str.Sub(8).Size(), 2);
+
+    med::ArenaString line(pool);
+    for (int i = 0; i < 1000; ++i) {
+        line += "field,";
+    }
+    size_t used_allocs = med_test::AllocCount() - allocs;
+    EXPECT_EQ(used_allocs, 0);
+    EXPECT_EQ(line.Size(), 6000);
+    EXPECT_EQ(line.CStr()[6000], '\0');
+    EXPECT_EQ(line.Str().substr(0, 12), "field,field,");
+    EXPECT_NE(line, str);
+}
+
+TEST(MemPool, Stats) {
+    med::MemPool pool(1000, 100000, 0);
+    pool.Alloc(600);
+    pool.Alloc(600);
+    pool.Create<std::string>("x");
+    med::MemPoolStats stats = pool.Stats();
+    // the destructor record of the string is not counted
+    EXPECT_EQ(stats.allocations, 3);
+    EXPECT_EQ(stats.allocated_bytes, 1200 + sizeof(std::string));
+    EXPECT_EQ(stats.block_appends, 1);
+    EXPECT_EQ(stats.wasted_bytes, 400);
+    EXPECT_EQ(stats.peak_used, pool.Used());
+    size_t peak = pool.Used();
+    pool.Reset();
+    pool.Alloc(10);
+    stats = pool.Stats();
+    EXPECT_EQ(stats.resets, 1);
+    EXPECT_EQ(stats.peak_used, peak);
+    EXPECT_EQ(stats.high_water, peak);
+    pool.ResetStats();
+    EXPECT_EQ(pool.Stats().allocations, 0);
+
+    // auto sizing: steady requests of 10 KB with one outlier of 1 MB
+    med::MemPool sized(1024, 64 * 1024, 0);
+    sized.EnableAutoSizing(0.5);
+    auto request = [&](size_t bytes) {
+        for (size_t done = 0; done < bytes; done += 100) {
+            sized.Alloc(100);
+        }
+        sized.Reset();
+    };
+    request(10 * 1024);
+    // the first block now holds a whole request
+    size_t appends = sized.Stats().block_appends;
+    request(10 * 1024);
+    EXPECT_EQ(sized.Stats().block_appends, appends);
+    EXPECT_GE(sized.AllocatedSize(), 10 * 1024);
+    EXPECT_LE(sized.AllocatedSize(), 20 * 1024);
+
+    request(1024 * 1024);
+    EXPECT_GE(sized.AllocatedSize(), 1024 * 1024);
+    // the outlier decays away and the first block shrinks back
+    for (int i = 0; i < 10; ++i) {
+        request(10 * 1024);
+    }
+    EXPECT_LE(sized.AllocatedSize(), 20 * 1024);
+    appends = sized.Stats().block_appends;
+    request(10 * 1024);
+    EXPECT_EQ(sized.Stats().block_appends, appends);
+
+    // the destructor gives the blocks back without resizing the first one
+    CountingSource source;
+    int destroyed = 0;
+    int block_allocs = 0;
+    {
+        med::MemPool pool(1024, 64 * 1024, 0, &source);
+        pool.EnableAutoSizing();
+        pool.Create<Tracked>(&destroyed, std::unique_ptr<int>(new int(1)));
+        for (int i = 0; i < 100; ++i) {
+            pool.Alloc(100);
+        }
+        block_allocs = source.allocs_;
+    }
+    EXPECT_EQ(destroyed, 1);
+    EXPECT_EQ(source.allocs_, block_allocs);
+    EXPECT_EQ(source.frees_, block_allocs);
+}
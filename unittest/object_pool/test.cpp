@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "object_pool/object_pool.h"
+#include "object_pool/pooled_allocator.h"
 
 #include <vector>
 
@@ -217,4 +218,23 @@ TEST(ObjectPool, OutOfCapacity) {
             data_list.push_back(d);
         }
     }
-}
\ No newline at end of file
+}
+
+TEST(ObjectPool, PooledAllocator) {
+    ::med::PooledAllocator<Point> alloc;
+    Point* p1 = alloc.allocate(1);
+    alloc.deallocate(p1, 1);
+    // a released slot is handed out again
+    Point* p2 = alloc.allocate(1);
+    EXPECT_EQ(p1, p2);
+    alloc.deallocate(p2, 1);
+
+    // rebound allocators of the same size share slots
+    std::allocator_traits<::med::PooledAllocator<Point>>::rebind_alloc<std::pair<int, int>> other(alloc);
+    std::pair<int, int>* p3 = other.allocate(1);
+    EXPECT_EQ(reinterpret_cast<void*>(p3), reinterpret_cast<void*>(p1));
+    other.deallocate(p3, 1);
+
+    Point* arr = alloc.allocate(10);
+    alloc.deallocate(arr, 10);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "thread_pool/coroutine.h"
+
+namespace {
+
+med::Task<int> Square(med::ThreadPool& pool, int v) {
+    co_await pool.Schedule();
+    co_return v * v;
+}
+
+med::Task<int> SumOfSquares(med::ThreadPool& pool, int n) {
+    std::vector<med::Task<int>> tasks;
+    for (int i = 0; i < n; ++i) {
+        tasks.push_back(Square(pool, i));
+    }
+    std::vector<int> squares = co_await med::WhenAll(pool, std::move(tasks));
+    int sum = 0;
+    for (int v : squares) {
+        sum += v;
+    }
+    co_return sum;
+}
+
+med::Task<void> Fail(med::ThreadPool& pool) {
+    co_await pool.Schedule();
+    throw std::runtime_error("boom");
+}
+
+}  // namespace
+
+TEST(Coroutine, Schedule) {
+    med::ThreadPool pool(2);
+    auto main_id = std::this_thread::get_id();
+    auto task = [](med::ThreadPool& pool) -> med::Task<std::thread::id> {
+        co_await pool.Schedule();
+        co_return std::this_thread::get_id();
+    }(pool);
+    EXPECT_NE(med::SyncWait(std::move(task)), main_id);
+}
+
+TEST(Coroutine, ChainAndFanOut) {
+    med::ThreadPool pool(2);
+    EXPECT_EQ(med::SyncWait(Square(pool, 7)), 49);
+    EXPECT_EQ(med::SyncWait(SumOfSquares(pool, 100)), 328350);
+    // a single worker is enough, nobody blocks inside the pool
+    med::ThreadPool single(1);
+    EXPECT_EQ(med::SyncWait(SumOfSquares(single, 100)), 328350);
+}
+
+TEST(Coroutine, Exception) {
+    med::ThreadPool pool(2);
+    EXPECT_THROW(med::SyncWait(Fail(pool)), std::runtime_error);
+
+    auto outer = [](med::ThreadPool& pool) -> med::Task<void> {
+        std::vector<med::Task<void>> tasks;
+        tasks.push_back(Fail(pool));
+        co_await med::WhenAll(pool, std::move(tasks));
+    }(pool);
+    EXPECT_THROW(med::SyncWait(std::move(outer)), std::runtime_error);
+}
+
+TEST(Coroutine, Spawn) {
+    med::ThreadPool pool(2);
+    std::atomic<int> done{0};
+    for (int i = 0; i < 10; ++i) {
+        med::Spawn(pool, [](std::atomic<int>& done) -> med::Task<void> {
+            ++done;
+            co_return;
+        }(done));
+    }
+    while (done.load() < 10) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(done.load(), 10);
+}
+
+TEST(Coroutine, ScheduleUnderDropOldest) {
+    med::ThreadPoolOptions options;
+    options.concurrency_num = 1;
+    options.queue_capacity = 1;
+    options.overflow_policy = med::OverflowPolicy::kDropOldest;
+    med::ThreadPool pool(options);
+    std::promise<void> open;
+    std::shared_future<void> opened = open.get_future().share();
+    pool.Execute([opened]() { opened.wait(); });
+
+    // the resume of the coroutine waits in the full queue, the tasks submitted after it must not drop it
+    int result = 0;
+    std::thread waiter([&pool, &result]() { result = med::SyncWait(Square(pool, 6)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::thread opener([&open]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        open.set_value();
+    });
+    for (int i = 0; i < 20; ++i) {
+        pool.Execute([]() {});
+    }
+    opener.join();
+    waiter.join();
+    EXPECT_EQ(result, 36);
+}
+
+TEST(Coroutine, Refused) {
+    med::ThreadPoolOptions options;
+    options.concurrency_num = 1;
+    options.queue_capacity = 1;
+    options.overflow_policy = med::OverflowPolicy::kReject;
+    med::ThreadPool pool(options);
+    std::promise<void> open;
+    std::shared_future<void> opened = open.get_future().share();
+    pool.Execute([opened]() { opened.wait(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::promise<void> drained;
+    pool.Execute([&drained]() { drained.set_value(); });
+
+    // the pool refuses every coroutine now, that must surface as an error instead of terminating
+    EXPECT_THROW(med::Spawn(pool, Fail(pool)), med::QueueFullError);
+    EXPECT_THROW(med::SyncWait(SumOfSquares(pool, 3)), med::QueueFullError);
+    open.set_value();
+    drained.get_future().wait();
+    EXPECT_EQ(med::SyncWait(Square(pool, 6)), 36);
+}
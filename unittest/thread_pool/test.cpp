@@ -1,8 +1,20 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
 #include <thread>
 #include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
 #include <future>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include "thread_pool/parallel_algorithm.h"
+#include "thread_pool/task_graph.h"
 #include "thread_pool/thread_pool.h"
+#include "unittest/common/alloc_counter.h"
 
 TEST(ThreadPool, Basic) {
     ::med::ThreadPool pool(2);
@@ -24,3 +36,913 @@ TEST(ThreadPool, Basic) {
     EXPECT_LE(cost.count(), 70);
     EXPECT_EQ(sum.load(), 10);
 }
+
+TEST(ThreadPool, WorkStealing) {
+    ::med::ThreadPoolOptions options;
+    options.concurrency_num = 4;
+    options.work_stealing = true;
+    ::med::ThreadPool pool(options);
+
+    std::atomic<int> sum{0};
+    std::mutex mutex;
+    std::set<std::thread::id> thread_ids;
+    // children are pushed to the root worker's own deque, the root keeps its worker busy so others must steal
+    auto root = pool.Enqueue([&]() {
+        for (int i = 0; i < 100; ++i) {
+            pool.Enqueue([&]() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    thread_ids.insert(std::this_thread::get_id());
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                ++sum;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    });
+    root.get();
+    while (sum.load() < 100) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(sum.load(), 100);
+    EXPECT_GT(thread_ids.size(), 1);
+    EXPECT_EQ(pool.PendingApprox(), 0);
+}
+
+TEST(ThreadPool, ParkAndWake) {
+    ::med::ThreadPoolOptions options;
+    options.concurrency_num = 4;
+    options.spin_count = 0;
+    options.yield_count = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        ::med::ThreadPool pool(options);
+        for (int round = 0; round < 5; ++round) {
+            // let every worker park, then make sure a single submission wakes one up
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            EXPECT_EQ(pool.Enqueue([round]() { return round; }).get(), round);
+        }
+    }
+    // parked workers are woken by the destructor instead of timing out
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> cost = end - start;
+    EXPECT_LE(cost.count(), 100);
+}
+
+TEST(ThreadPool, UniqueTask) {
+    ::med::UniqueTask empty;
+    EXPECT_TRUE(empty == nullptr);
+
+    // move-only callable stored inline
+    std::unique_ptr<int> value(new int(1));
+    int* raw = value.get();
+    struct Inc {
+        std::unique_ptr<int> value;
+        void operator()() { ++*value; }
+    };
+    ::med::UniqueTask small(Inc{std::move(value)});
+    ::med::UniqueTask moved(std::move(small));
+    EXPECT_TRUE(small == nullptr);
+    moved();
+    EXPECT_EQ(*raw, 2);
+
+    // callable larger than the inline buffer goes to the heap
+    std::array<int, 64> big;
+    big.fill(1);
+    int sum = 0;
+    ::med::UniqueTask large([big, &sum]() {
+        for (int v : big) {
+            sum += v;
+        }
+    });
+    EXPECT_FALSE((::med::UniqueTask::IsInline<std::array<int, 64>>()));
+    moved = std::move(large);
+    moved();
+    EXPECT_EQ(sum, 64);
+}
+
+TEST(ThreadPool, AllocationFreeEnqueue) {
+    ::med::ThreadPool pool(2);
+    std::atomic<int> sum{0};
+    auto submit = [&pool, &sum](int n) {
+        for (int i = 0; i < n; ++i) {
+            pool.Enqueue([&sum, i]() { sum += i; }).get();
+            EXPECT_EQ(pool.Enqueue([i](int x) { return i + x; }, 1).get(), i + 1);
+        }
+    };
+    // warm up queue blocks, slot pools and per-thread producers
+    submit(1000);
+    size_t before = ::med_test::AllocCount();
+    submit(1000);
+    EXPECT_EQ(::med_test::AllocCount() - before, 0);
+    EXPECT_EQ(sum.load(), 2 * 999 * 1000 / 2);
+
+    // exceptions still reach the future
+    auto failed = pool.Enqueue([]() -> int { throw std::runtime_error("boom"); });
+    EXPECT_THROW(failed.get(), std::runtime_error);
+}
+
+TEST(ThreadPool, ExecuteAndBulk) {
+    ::med::ThreadPool pool(2);
+    std::atomic<int> sum{0};
+    for (int i = 0; i < 10; ++i) {
+        pool.Execute([&sum](int x) { sum += x; }, i);
+    }
+
+    std::vector<std::function<void()>> tasks;
+    for (int i = 0; i < 1000; ++i) {
+        tasks.push_back([&sum]() { ++sum; });
+    }
+    pool.ExecuteBulk(tasks.begin(), tasks.end());
+
+    std::vector<std::function<int()>> jobs;
+    for (int i = 0; i < 200; ++i) {
+        jobs.push_back([i]() { return i * i; });
+    }
+    auto futures = pool.EnqueueBulk(jobs.begin(), jobs.end());
+    ASSERT_EQ(futures.size(), 200);
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_EQ(futures[i].get(), i * i);
+    }
+
+    while (sum.load() < 45 + 1000) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(sum.load(), 45 + 1000);
+}
+
+TEST(ThreadPool, Priority) {
+    ::med::ThreadPoolOptions options;
+    options.concurrency_num = 1;
+    options.starvation_interval = 0;
+    options.track_queue_wait = true;
+    ::med::ThreadPool pool(options);
+
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    pool.Execute([opened]() { opened.wait(); });
+
+    std::mutex mutex;
+    std::vector<int> order;
+    std::vector<std::future<void>> futures;
+    auto record = [&mutex, &order](int v) {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(v);
+    };
+    for (int i = 0; i < 5; ++i) {
+        futures.push_back(pool.EnqueueWithPriority(::med::TaskPriority::kLow, record, 2));
+        futures.push_back(pool.Enqueue(record, 1));
+        futures.push_back(pool.EnqueueWithPriority(::med::TaskPriority::kHigh, record, 0));
+    }
+    gate.set_value();
+    for (auto&& f : futures) {
+        f.get();
+    }
+    ASSERT_EQ(order.size(), 15);
+    EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+    EXPECT_EQ(pool.QueueWaitHistogram(::med::TaskPriority::kHigh).Count(), 5);
+    EXPECT_EQ(pool.QueueWaitHistogram(::med::TaskPriority::kLow).Count(), 5);
+    EXPECT_GT(pool.QueueWaitHistogram(::med::TaskPriority::kLow).Percentile(0.5), 0);
+}
+
+TEST(ThreadPool, PriorityStarvation) {
+    ::med::ThreadPoolOptions options;
+    options.concurrency_num = 1;
+    options.starvation_interval = 4;
+    ::med::ThreadPool pool(options);
+
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    pool.Execute([opened]() { opened.wait(); });
+
+    std::atomic<int> high_done{0};
+    std::atomic<int> high_done_at_first_low{-1};
+    for (int i = 0; i < 40; ++i) {
+        pool.ExecuteWithPriority(::med::TaskPriority::kHigh, [&high_done]() { ++high_done; });
+    }
+    auto low = pool.EnqueueWithPriority(::med::TaskPriority::kLow,
+                                        [&]() { high_done_at_first_low = high_done.load(); });
+    gate.set_value();
+    low.get();
+    // the low lane gets a turn long before the high lane is empty
+    EXPECT_LT(high_done_at_first_low.load(), 40);
+}
+
+TEST(ThreadPool, CpuPlacement) {
+    EXPECT_EQ(::med::ParseCpuList("0-3,8,10-11\n"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(::med::ParseCpuList("x,5-2,7"), std::vector<int>{7});
+    EXPECT_FALSE(::med::CpuTopology::Detect().Empty());
+
+    // every worker pinned to cpu 0, which every machine has
+    ::med::ThreadPoolOptions pinned;
+    pinned.concurrency_num = 2;
+    pinned.cpu_set = {0};
+    ::med::ThreadPool pinned_pool(pinned);
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(pinned_pool.Enqueue([]() { return ::med::CurrentCpu(); }).get(), 0);
+    }
+
+    // a fake two node topology, both nodes on cpu 0
+    ::med::ThreadPoolOptions numa;
+    numa.concurrency_num = 4;
+    numa.numa_aware = true;
+    numa.work_stealing = true;
+    numa.topology = ::med::CpuTopology({{0}, {0}, {}});
+    ::med::ThreadPool pool(numa);
+    ASSERT_EQ(pool.NodeNum(), 2);
+    for (size_t i = 0; i < pool.Size(); ++i) {
+        EXPECT_EQ(pool.WorkerNode(i), i % 2);
+    }
+    std::atomic<int> sum{0};
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 100; ++i) {
+        futures.push_back(pool.Enqueue([&pool, &sum]() {
+            std::vector<std::future<void>> children;
+            for (int j = 0; j < 10; ++j) {
+                children.push_back(pool.Enqueue([&sum]() { ++sum; }));
+            }
+            for (auto& child : children) {
+                while (child.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    pool.RunPendingTask();
+                }
+            }
+        }));
+    }
+    for (int i = 0; i < 100; ++i) {
+        pool.ExecuteWithPriority(::med::TaskPriority::kHigh, [&sum]() { ++sum; });
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    while (sum.load() < 1100) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(sum.load(), 1100);
+
+    // the cpu set drops the second node, so the pool runs as a single node
+    numa.topology = ::med::CpuTopology({{0}, {1}});
+    numa.cpu_set = {0};
+    EXPECT_EQ(::med::ThreadPool(numa).NodeNum(), 1);
+}
+
+TEST(ThreadPool, Elastic) {
+    ::med::ThreadPoolOptions options;
+    options.concurrency_num = 1;
+    options.elastic = true;
+    options.max_concurrency_num = 4;
+    options.scale_up_backlog = 1;
+    options.idle_timeout_ms = 20;
+    options.spin_count = 0;
+    options.yield_count = 0;
+    ::med::ThreadPool pool(options);
+    EXPECT_EQ(pool.Size(), 1);
+
+    // a burst piles up behind the single worker and grows the pool
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 40; ++i) {
+        futures.push_back(pool.Enqueue([]() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); }));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    ::med::ScalingCounters scaling = pool.Scaling();
+    EXPECT_GT(scaling.scale_up_on_backlog + scaling.scale_up_on_queue_wait, 0);
+    EXPECT_GT(scaling.peak_workers, 1);
+    EXPECT_LE(scaling.peak_workers, 4);
+
+    // idle workers retire down to concurrency_num
+    for (int i = 0; i < 200 && pool.Size() > 1; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(pool.Size(), 1);
+    EXPECT_GT(pool.Scaling().retired_on_idle, 0);
+    EXPECT_EQ(pool.Enqueue([]() { return 7; }).get(), 7);
+
+    // a long queue wait alone is enough to add a worker
+    options.scale_up_backlog = 1000;
+    options.scale_up_queue_wait_us = 1000;
+    ::med::ThreadPool waiting(options);
+    futures.clear();
+    for (int i = 0; i < 10; ++i) {
+        futures.push_back(waiting.Enqueue([]() { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    EXPECT_GT(waiting.Scaling().scale_up_on_queue_wait, 0);
+    EXPECT_EQ(waiting.Scaling().scale_up_on_backlog, 0);
+}
+
+TEST(ThreadPool, Stats) {
+    ::med::ThreadPoolOptions options;
+    options.concurrency_num = 2;
+    options.collect_stats = true;
+    options.trace = true;
+    ::med::ThreadPool pool(options);
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 20; ++i) {
+        futures.push_back(pool.Enqueue([]() { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    // one more run by the calling thread
+    pool.Execute([]() {});
+    while (!pool.RunPendingTask() && pool.Stats().tasks_executed < 21) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    ::med::ThreadPoolStats stats = pool.Stats();
+    EXPECT_EQ(stats.tasks_executed, 21);
+    EXPECT_EQ(stats.workers, 2);
+    EXPECT_EQ(stats.queue_depth, 0);
+    EXPECT_EQ(stats.queue_wait.Count(), 21);
+    EXPECT_EQ(stats.exec_time.Count(), 21);
+    EXPECT_GE(stats.exec_time.Percentile(0.5), 1000000);
+    ASSERT_EQ(stats.per_worker.size(), 3);
+    uint64_t tasks = 0;
+    for (size_t i = 0; i < 2; ++i) {
+        tasks += stats.per_worker[i].tasks;
+        EXPECT_GT(stats.per_worker[i].idle_ns, 0);
+        EXPECT_LE(stats.per_worker[i].Utilization(), 1);
+    }
+    EXPECT_GE(stats.per_worker[0].busy_ns + stats.per_worker[1].busy_ns, 20000000);
+    EXPECT_EQ(tasks + stats.per_worker[2].tasks, 21);
+
+    std::string path = ::testing::TempDir() + "thread_pool_trace.json";
+    ASSERT_TRUE(pool.WriteTrace(path));
+    std::ifstream in(path);
+    std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(json.compare(0, 15, "{\"traceEvents\":"), 0);
+    size_t events = 0;
+    for (size_t pos = json.find("\"ph\":\"X\""); pos != std::string::npos; pos = json.find("\"ph\":\"X\"", pos + 1)) {
+        ++events;
+    }
+    EXPECT_EQ(events, 21);
+    std::remove(path.c_str());
+
+    pool.ResetStats();
+    EXPECT_EQ(pool.Stats().tasks_executed, 0);
+}
+
+// keeps a worker busy until the gate opens, so the queue of a bounded pool fills up
+struct Gate {
+    std::promise<void> open;
+    std::shared_future<void> opened = open.get_future().share();
+    void Block(::med::ThreadPool& pool) {
+        std::promise<void> started;
+        std::shared_future<void> gate = this->opened;
+        pool.Execute([gate, &started]() {
+            started.set_value();
+            gate.wait();
+        });
+        started.get_future().wait();
+    }
+};
+
+TEST(ThreadPool, BoundedQueue) {
+    auto make_options = [](::med::OverflowPolicy policy) {
+        ::med::ThreadPoolOptions options;
+        options.concurrency_num = 1;
+        options.queue_capacity = 2;
+        options.overflow_policy = policy;
+        options.block_timeout_us = 10000;
+        return options;
+    };
+    {
+        ::med::ThreadPool pool(make_options(::med::OverflowPolicy::kReject));
+        Gate gate;
+        gate.Block(pool);
+        auto first = pool.Enqueue([]() { return 1; });
+        pool.Execute([]() {});
+        EXPECT_THROW(pool.Execute([]() {}), ::med::QueueFullError);
+        EXPECT_FALSE(pool.TryEnqueue([]() { return 2; }).valid());
+        EXPECT_FALSE(pool.TryExecute([]() {}));
+        gate.open.set_value();
+        EXPECT_EQ(first.get(), 1);
+        EXPECT_EQ(pool.Admission().rejected, 3);
+        EXPECT_TRUE(pool.TryEnqueue([]() { return 2; }).valid());
+    }
+    {
+        ::med::ThreadPool pool(make_options(::med::OverflowPolicy::kCallerRuns));
+        Gate gate;
+        gate.Block(pool);
+        pool.Execute([]() {});
+        pool.Execute([]() {});
+        EXPECT_EQ(pool.Enqueue([]() { return std::this_thread::get_id(); }).get(), std::this_thread::get_id());
+        gate.open.set_value();
+        EXPECT_EQ(pool.Admission().caller_runs, 1);
+    }
+    {
+        ::med::ThreadPool pool(make_options(::med::OverflowPolicy::kDropOldest));
+        Gate gate;
+        gate.Block(pool);
+        auto oldest = pool.Enqueue([]() { return 1; });
+        auto second = pool.Enqueue([]() { return 2; });
+        auto third = pool.Enqueue([]() { return 3; });
+        gate.open.set_value();
+        EXPECT_THROW(oldest.get(), std::future_error);
+        EXPECT_EQ(second.get() + third.get(), 5);
+        EXPECT_EQ(pool.Admission().dropped, 1);
+    }
+    {
+        ::med::ThreadPool pool(make_options(::med::OverflowPolicy::kBlock));
+        Gate gate;
+        gate.Block(pool);
+        pool.Execute([]() {});
+        pool.Execute([]() {});
+        // times out while the worker is stuck
+        EXPECT_FALSE(pool.TryExecute([]() {}));
+        // gets in as soon as the worker makes room
+        std::thread opener([&gate]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            gate.open.set_value();
+        });
+        EXPECT_EQ(pool.Enqueue([]() { return 4; }).get(), 4);
+        opener.join();
+        ::med::AdmissionCounters admission = pool.Admission();
+        EXPECT_EQ(admission.blocked, 2);
+        EXPECT_EQ(admission.block_timeouts, 1);
+        EXPECT_EQ(admission.rejected, 1);
+
+        // a worker that finds its own pool full runs the task instead of waiting for itself
+        std::future<int> nested = pool.Enqueue([&pool]() {
+            pool.Execute([]() {});
+            pool.Execute([]() {});
+            return pool.Enqueue([]() { return 5; }).get();
+        });
+        EXPECT_EQ(nested.get(), 5);
+        EXPECT_EQ(pool.Admission().caller_runs, 1);
+    }
+}
+
+TEST(ThreadPool, BoundedQueueBulk) {
+    // two busy workers and room for 4 of the 10 tasks, the policies that wait or drop need the earlier tasks of the
+    // batch in the queue
+    auto make_options = [](::med::OverflowPolicy policy) {
+        ::med::ThreadPoolOptions options;
+        options.concurrency_num = 2;
+        options.queue_capacity = 4;
+        options.overflow_policy = policy;
+        return options;
+    };
+    std::atomic<int> executed{0};
+    std::vector<std::function<void()>> tasks(10, [&executed]() { ++executed; });
+
+    {
+        ::med::ThreadPool pool(make_options(::med::OverflowPolicy::kReject));
+        Gate gate;
+        gate.Block(pool);
+        gate.Block(pool);
+        EXPECT_THROW(pool.ExecuteBulk(tasks.begin(), tasks.end()), ::med::QueueFullError);
+        gate.open.set_value();
+        EXPECT_EQ(pool.Admission().rejected, 1);
+    }
+    EXPECT_EQ(executed.exchange(0), 4);
+    {
+        ::med::ThreadPool pool(make_options(::med::OverflowPolicy::kCallerRuns));
+        Gate gate;
+        gate.Block(pool);
+        gate.Block(pool);
+        pool.ExecuteBulk(tasks.begin(), tasks.end());
+        EXPECT_EQ(executed.load(), 6);
+        gate.open.set_value();
+        EXPECT_EQ(pool.Admission().caller_runs, 6);
+    }
+    EXPECT_EQ(executed.exchange(0), 10);
+    {
+        ::med::ThreadPool pool(make_options(::med::OverflowPolicy::kDropOldest));
+        Gate gate;
+        gate.Block(pool);
+        gate.Block(pool);
+        pool.ExecuteBulk(tasks.begin(), tasks.end());
+        gate.open.set_value();
+        EXPECT_EQ(pool.Admission().dropped, 6);
+    }
+    EXPECT_EQ(executed.exchange(0), 4);
+    {
+        ::med::ThreadPool pool(make_options(::med::OverflowPolicy::kBlock));
+        Gate gate;
+        gate.Block(pool);
+        gate.Block(pool);
+        std::thread opener([&gate]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            gate.open.set_value();
+        });
+        auto futures = pool.EnqueueBulk(tasks.begin(), tasks.end());
+        for (auto& future : futures) {
+            future.get();
+        }
+        opener.join();
+        EXPECT_GE(pool.Admission().blocked, 1);
+    }
+    EXPECT_EQ(executed.exchange(0), 10);
+}
+
+TEST(ThreadPool, DropOldestKeepsTimers) {
+    ::med::ThreadPoolOptions options;
+    options.concurrency_num = 1;
+    options.queue_capacity = 2;
+    options.overflow_policy = ::med::OverflowPolicy::kDropOldest;
+    ::med::ThreadPool pool(options);
+    Gate gate;
+    gate.Block(pool);
+    std::atomic<int> ticks{0};
+    ::med::TimerId every = pool.ScheduleEvery(std::chrono::milliseconds(1), [&ticks]() { ++ticks; });
+    // the first run waits in the queue behind the busy worker, the next ones are skipped meanwhile
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    // a full queue drops the submitted tasks but never the run of the timer, which would stop it for good
+    for (int i = 0; i < 20; ++i) {
+        pool.Execute([]() {});
+    }
+    EXPECT_EQ(pool.Admission().dropped, 19);
+    gate.open.set_value();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (ticks.load() < 3 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_GE(ticks.load(), 3);
+    pool.CancelTimer(every);
+}
+
+TEST(TimingWheel, Expiry) {
+    ::med::TimingWheel<int> wheel;
+    std::vector<uint64_t> expires = {1, 2, 63, 64, 65, 100, 4095, 4096, 4097, 300000, 1u << 24, (1u << 24) + 5,
+                                     uint64_t(1) << 30};
+    for (size_t i = 0; i < expires.size(); ++i) {
+        EXPECT_NE(wheel.Add(expires[i], 0, int(i)), wheel.kInvalidId);
+    }
+    uint64_t cancelled = wheel.Add(50, 0, -1);
+    EXPECT_TRUE(wheel.Cancel(cancelled));
+    EXPECT_FALSE(wheel.Cancel(cancelled));
+    EXPECT_EQ(wheel.Add(0, 0, -1), wheel.kInvalidId);
+    EXPECT_EQ(wheel.Size(), expires.size());
+
+    // every timer fires exactly at its tick, whatever steps the wheel is moved in
+    std::vector<uint64_t> fired;
+    uint64_t step = 1;
+    while (wheel.Size() > 0) {
+        uint64_t target = std::min(wheel.CurrentTick() + step, wheel.NextTick());
+        step = step * 3 % 100000 + 1;
+        wheel.Advance(target, [&](int& i, bool) {
+            EXPECT_EQ(wheel.CurrentTick(), expires[i]);
+            fired.push_back(expires[i]);
+        });
+    }
+    EXPECT_EQ(fired, expires);
+
+    // big jumps fire late but in order, periodic timers come back
+    uint64_t periodic = wheel.Add(wheel.CurrentTick() + 10, 10, 7);
+    int runs = 0;
+    wheel.Advance(wheel.CurrentTick() + 105, [&](int& i, bool periodic_timer) {
+        EXPECT_EQ(i, 7);
+        EXPECT_TRUE(periodic_timer);
+        ++runs;
+    });
+    EXPECT_EQ(runs, 10);
+    EXPECT_TRUE(wheel.Cancel(periodic));
+    EXPECT_EQ(wheel.Size(), 0);
+
+    // random adds, cancels and steps against the expected expiry of every timer
+    ::med::TimingWheel<int> random_wheel;
+    std::vector<uint64_t> expected;
+    std::vector<uint64_t> ids;
+    uint64_t seed = 42;
+    auto next_random = [&seed]() {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+    int fired_num = 0;
+    for (int round = 0; round < 2000; ++round) {
+        for (int i = 0; i < 5; ++i) {
+            uint64_t delay = 1 + next_random() % (i == 0 ? 300000 : 5000);
+            ids.push_back(random_wheel.Add(random_wheel.CurrentTick() + delay, 0, int(expected.size())));
+            expected.push_back(random_wheel.CurrentTick() + delay);
+        }
+        size_t victim = next_random() % ids.size();
+        if (random_wheel.Cancel(ids[victim])) {
+            expected[victim] = 0;
+        }
+        random_wheel.Advance(random_wheel.CurrentTick() + next_random() % 200, [&](int& i, bool) {
+            EXPECT_EQ(random_wheel.CurrentTick(), expected[i]);
+            expected[i] = 0;
+            ++fired_num;
+        });
+    }
+    random_wheel.Advance(uint64_t(1) << 40, [&](int& i, bool) {
+        EXPECT_EQ(random_wheel.CurrentTick(), expected[i]);
+        expected[i] = 0;
+        ++fired_num;
+    });
+    EXPECT_EQ(random_wheel.Size(), 0);
+    EXPECT_EQ(std::count(expected.begin(), expected.end(), 0u), static_cast<long>(expected.size()));
+    EXPECT_GT(fired_num, 9000);
+}
+
+TEST(ThreadPool, Timers) {
+    ::med::ThreadPool pool(2);
+    auto start = std::chrono::steady_clock::now();
+    std::promise<std::chrono::steady_clock::time_point> after;
+    pool.ScheduleAfter(std::chrono::milliseconds(20),
+                       [&after]() { after.set_value(std::chrono::steady_clock::now()); });
+    std::promise<void> at;
+    pool.ScheduleAt(std::chrono::system_clock::now() + std::chrono::milliseconds(10), [&at]() { at.set_value(); });
+    std::atomic<int> cancelled_runs{0};
+    ::med::TimerId cancelled = pool.ScheduleAfter(std::chrono::milliseconds(10), [&]() { ++cancelled_runs; });
+    EXPECT_TRUE(pool.CancelTimer(cancelled));
+    EXPECT_FALSE(pool.CancelTimer(cancelled));
+
+    std::atomic<int> ticks{0};
+    ::med::TimerId every = pool.ScheduleEvery(std::chrono::milliseconds(5), [&ticks]() { ++ticks; });
+    EXPECT_GE(after.get_future().get() - start, std::chrono::milliseconds(20));
+    at.get_future().get();
+    while (ticks.load() < 3) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(pool.CancelTimer(every));
+    int ticks_at_cancel = ticks.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_LE(ticks.load(), ticks_at_cancel + 1);
+    EXPECT_EQ(cancelled_runs.load(), 0);
+    EXPECT_EQ(pool.PendingTimers(), 0);
+
+    // lots of timers at once, a past deadline runs right away
+    std::atomic<int> fired{0};
+    const int kTimers = 100000;
+    for (int i = 0; i < kTimers; ++i) {
+        pool.ScheduleAfter(std::chrono::microseconds(i % 20000), [&fired]() { ++fired; });
+    }
+    pool.ScheduleAt(std::chrono::steady_clock::now() - std::chrono::seconds(1), [&fired]() { ++fired; });
+    while (fired.load() < kTimers + 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(pool.PendingTimers(), 0);
+}
+
+TEST(LatencyHistogram, Percentile) {
+    ::med::LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 10000; ++v) {
+        histogram.Record(v * 1000);
+    }
+    EXPECT_EQ(histogram.Count(), 10000);
+    EXPECT_EQ(histogram.Max(), 10000 * 1000);
+    EXPECT_NEAR(histogram.Mean(), 5000.5 * 1000, 1);
+    EXPECT_NEAR(histogram.Percentile(0.5), 5000 * 1000, 5000 * 1000 * 0.07);
+    EXPECT_NEAR(histogram.Percentile(0.99), 9900 * 1000, 9900 * 1000 * 0.07);
+    EXPECT_EQ(histogram.Percentile(1.0), 10000 * 1000);
+    const int bucket_num = ::med::LatencyHistogram::kBucketNum;
+    for (uint64_t v : {0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, ~0ull}) {
+        int idx = ::med::LatencyHistogram::BucketIndex(v);
+        ASSERT_LT(idx, bucket_num);
+        EXPECT_GE(::med::LatencyHistogram::BucketUpperBound(idx), v);
+    }
+}
+
+TEST(ParallelAlgorithm, ForAndReduce) {
+    for (bool work_stealing : {false, true}) {
+        ::med::ThreadPoolOptions options;
+        options.concurrency_num = 3;
+        options.work_stealing = work_stealing;
+        ::med::ThreadPool pool(options);
+
+        std::vector<int> data(100000);
+        ::med::ParallelFor(pool, size_t(0), data.size(), 0, [&data](size_t i) { data[i] = static_cast<int>(i); });
+        for (size_t i = 0; i < data.size(); ++i) {
+            ASSERT_EQ(data[i], static_cast<int>(i));
+        }
+
+        int64_t sum = ::med::ParallelReduce(
+            pool, data.begin(), data.end(), 1000, int64_t(0),
+            [](std::vector<int>::iterator b, std::vector<int>::iterator e, int64_t init) {
+                return std::accumulate(b, e, init);
+            },
+            [](int64_t a, int64_t b) { return a + b; });
+        EXPECT_EQ(sum, int64_t(99999) * 100000 / 2);
+
+        std::vector<int64_t> squares(data.size());
+        ::med::ParallelTransform(pool, data.begin(), data.end(), squares.begin(), 0,
+                                 [](int v) { return int64_t(v) * v; });
+        EXPECT_EQ(squares[99999], int64_t(99999) * 99999);
+
+        // empty ranges are fine
+        ::med::ParallelFor(pool, 5, 5, 1, [](int) { FAIL(); });
+    }
+}
+
+TEST(ParallelAlgorithm, Sort) {
+    ::med::ThreadPool pool(3);
+    std::vector<int> data(200000);
+    for (auto& v : data) {
+        v = rand() % 1000;  // plenty of duplicates
+    }
+    std::vector<int> expected = data;
+    std::sort(expected.begin(), expected.end());
+    ::med::ParallelSort(pool, data.begin(), data.end());
+    EXPECT_EQ(data, expected);
+
+    ::med::ParallelSort(pool, data.begin(), data.end(), std::greater<int>());
+    EXPECT_TRUE(std::is_sorted(data.rbegin(), data.rend()));
+}
+
+TEST(ParallelAlgorithm, NestedAndExceptions) {
+    // the waiting worker runs the nested chunks itself, so a single worker pool does not deadlock
+    ::med::ThreadPool pool(1);
+    auto outer = pool.Enqueue([&pool]() {
+        std::atomic<int> count{0};
+        ::med::ParallelFor(pool, 0, 1000, 10, [&count](int) { ++count; });
+        return count.load();
+    });
+    EXPECT_EQ(outer.get(), 1000);
+
+    EXPECT_THROW(::med::ParallelFor(pool, 0, 1000, 10,
+                                    [](int i) {
+                                        if (i == 500) throw std::runtime_error("boom");
+                                    }),
+                 std::runtime_error);
+}
+
+TEST(TaskGraph, Continuation) {
+    ::med::ThreadPool pool(2);
+    auto a = ::med::Async(pool, []() { return 20; });
+    auto add_one = [](int v) { return v + 1; };
+    auto b = a.Then(pool, add_one).Then(pool, [](int v) { return std::to_string(v * 2); });
+    EXPECT_EQ(b.Get(), "42");
+
+    std::atomic<int> calls{0};
+    auto failed = ::med::Async(pool, []() -> int { throw std::runtime_error("boom"); });
+    auto skipped = failed.Then(pool, [&calls](int) { ++calls; });
+    EXPECT_THROW(skipped.Get(), std::runtime_error);
+    EXPECT_EQ(calls.load(), 0);
+
+    ::med::Promise<void> promise;
+    auto after = promise.GetFuture().Then(pool, []() { return 7; });
+    EXPECT_FALSE(after.Ready());
+    promise.SetValue();
+    EXPECT_EQ(after.Get(), 7);
+}
+
+TEST(TaskGraph, WhenAllAndAny) {
+    ::med::ThreadPool pool(2);
+    std::vector<::med::Future<int>> futures;
+    for (int i = 0; i < 10; ++i) {
+        futures.push_back(::med::Async(pool, [i]() { return i; }));
+    }
+    auto sum = ::med::WhenAll(futures).Then(pool, [&futures]() {
+        int total = 0;
+        for (auto& f : futures) {
+            total += f.Get();
+        }
+        return total;
+    });
+    EXPECT_EQ(sum.Get(), 45);
+
+    ::med::Promise<int> slow;
+    std::vector<::med::Future<int>> race{slow.GetFuture(), ::med::Async(pool, []() { return 1; })};
+    EXPECT_EQ(::med::WhenAny(race).Get(), 1);
+    slow.SetValue(0);
+
+    std::vector<::med::Future<int>> with_error{::med::Async(pool, []() -> int { throw std::runtime_error("boom"); }),
+                                               ::med::Async(pool, []() { return 1; })};
+    EXPECT_THROW(::med::WhenAll(with_error).Get(), std::runtime_error);
+}
+
+TEST(TaskGraph, Dag) {
+    // a single worker must still make progress, nodes never wait on each other
+    ::med::ThreadPool pool(1);
+    ::med::TaskGraph graph;
+    std::atomic<int> step{0};
+    std::vector<int> seen(5, -1);
+    //      +-> b -+
+    //  a --+      +-> d -> e
+    //      +-> c -+
+    auto a = graph.AddNode([&]() { seen[0] = step++; });
+    auto b = graph.AddNode([&]() { seen[1] = step++; });
+    auto c = graph.AddNode([&]() { seen[2] = step++; });
+    auto d = graph.AddNode([&]() { seen[3] = step++; });
+    auto e = graph.AddNode([&]() { seen[4] = step++; });
+    graph.AddEdge(a, b);
+    graph.AddEdge(a, c);
+    graph.AddEdge(b, d);
+    graph.AddEdge(c, d);
+    graph.AddEdge(d, e);
+
+    for (int run = 0; run < 20; ++run) {
+        step = 0;
+        graph.Run(pool).Get();
+        EXPECT_EQ(seen[0], 0);
+        EXPECT_LT(seen[0], seen[1]);
+        EXPECT_LT(seen[0], seen[2]);
+        EXPECT_LT(seen[1], seen[3]);
+        EXPECT_LT(seen[2], seen[3]);
+        EXPECT_EQ(seen[4], 4);
+    }
+
+    graph.AddEdge(e, a);
+    EXPECT_THROW(graph.Run(pool), std::invalid_argument);
+
+    ::med::TaskGraph failing;
+    std::atomic<bool> after_failure{false};
+    auto f1 = failing.AddNode([]() { throw std::runtime_error("boom"); });
+    auto f2 = failing.AddNode([&after_failure]() { after_failure = true; });
+    failing.AddEdge(f1, f2);
+    EXPECT_THROW(failing.Run(pool).Get(), std::runtime_error);
+    EXPECT_FALSE(after_failure.load());
+}
+
+TEST(TaskGraph, RefusedByPool) {
+    ::med::ThreadPoolOptions options;
+    options.concurrency_num = 1;
+    options.queue_capacity = 1;
+    options.overflow_policy = ::med::OverflowPolicy::kReject;
+    ::med::ThreadPool pool(options);
+
+    // two roots, each with a successor
+    ::med::TaskGraph graph;
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 2; ++i) {
+        auto root = graph.AddNode([&ran]() { ++ran; });
+        graph.AddEdge(root, graph.AddNode([&ran]() { ++ran; }));
+    }
+
+    // a full queue refuses the first root: Run() throws and the graph stays usable
+    Gate gate;
+    gate.Block(pool);
+    std::promise<void> filler_done;
+    pool.Execute([&filler_done]() { filler_done.set_value(); });
+    EXPECT_THROW(graph.Run(pool), ::med::QueueFullError);
+    graph.AddNode([&ran]() { ++ran; });
+    gate.open.set_value();
+    filler_done.get_future().wait();
+
+    // room for the first root only: the run fails with the error and no node runs
+    Gate second;
+    second.Block(pool);
+    auto future = graph.Run(pool);
+    second.open.set_value();
+    EXPECT_THROW(future.Get(), ::med::QueueFullError);
+    EXPECT_EQ(ran.load(), 0);
+
+    ::med::ThreadPool unbounded(1);
+    graph.Run(unbounded).Get();
+    EXPECT_EQ(ran.load(), 5);
+}
+
+TEST(TaskGraph, RefusedMidRun) {
+    ::med::ThreadPoolOptions options;
+    options.concurrency_num = 1;
+    options.queue_capacity = 1;
+    options.overflow_policy = ::med::OverflowPolicy::kReject;
+    ::med::ThreadPool pool(options);
+
+    // the root fills the queue, so the successors it fans out to are refused on the worker
+    ::med::TaskGraph graph;
+    std::atomic<int> ran{0};
+    std::atomic<bool> fill{true};
+    auto root = graph.AddNode([&pool, &fill]() {
+        if (fill) {
+            pool.Execute([]() {});
+        }
+    });
+    for (int i = 0; i < 3; ++i) {
+        graph.AddEdge(root, graph.AddNode([&ran]() { ++ran; }));
+    }
+    EXPECT_THROW(graph.Run(pool).Get(), ::med::QueueFullError);
+    EXPECT_EQ(ran.load(), 0);
+
+    fill = false;
+    ::med::ThreadPool unbounded(2);
+    graph.Run(unbounded).Get();
+    EXPECT_EQ(ran.load(), 3);
+}
+
+TEST(TaskGraph, RefusedContinuation) {
+    ::med::ThreadPoolOptions options;
+    options.concurrency_num = 1;
+    options.queue_capacity = 1;
+    options.overflow_policy = ::med::OverflowPolicy::kReject;
+    ::med::ThreadPool pool(options);
+    ::med::ThreadPool other(1);
+    Gate gate;
+    gate.Block(pool);
+    pool.Execute([]() {});
+
+    // completed on this thread
+    ::med::Promise<int> promise;
+    auto refused = promise.GetFuture().Then(pool, [](int v) { return v; });
+    promise.SetValue(1);
+    EXPECT_THROW(refused.Get(), ::med::QueueFullError);
+
+    // completed by a task of another pool, the refusal must not reach the completing task
+    std::promise<void> go;
+    std::shared_future<void> started = go.get_future().share();
+    auto source = ::med::Async(other, [started]() {
+        started.wait();
+        return 2;
+    });
+    auto chained = source.Then(pool, [](int v) { return v; });
+    go.set_value();
+    EXPECT_EQ(source.Get(), 2);
+    EXPECT_THROW(chained.Get(), ::med::QueueFullError);
+    gate.open.set_value();
+}